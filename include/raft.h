@@ -96,6 +96,8 @@ struct raft_configuration
 {
     struct raft_server *servers; /* Array of servers member of the cluster. */
     unsigned n;                  /* Number of servers in the array. */
+    unsigned *index;             /* Hash index of servers by ID, or NULL. */
+    unsigned index_size;         /* Number of slots in the index. */
 };
 
 /**
@@ -308,6 +310,28 @@ struct raft_timeout_now
     raft_index last_log_term;  /* Term of log entry at last_log_index. */
 };
 
+/**
+ * Hold the arguments of a Forward message.
+ *
+ * The Forward message is sent by followers to the current leader, when
+ * proposal forwarding is enabled, with commands submitted via raft_apply().
+ */
+struct raft_forward
+{
+    raft_term term;             /* Follower's current term. */
+    struct raft_entry *entries; /* Commands to append. */
+    unsigned n_entries;         /* Size of the entries array. */
+};
+
+/**
+ * Hold the result of a Forward message.
+ */
+struct raft_forward_result
+{
+    raft_term term;   /* Term of the Forward message being replied. */
+    raft_index index; /* Index of the first appended entry, or 0 if rejected. */
+};
+
 /**
  * Type codes for RPC messages.
  */
@@ -317,7 +341,9 @@ enum {
     RAFT_IO_REQUEST_VOTE,
     RAFT_IO_REQUEST_VOTE_RESULT,
     RAFT_IO_INSTALL_SNAPSHOT,
-    RAFT_IO_TIMEOUT_NOW
+    RAFT_IO_TIMEOUT_NOW,
+    RAFT_IO_FORWARD,
+    RAFT_IO_FORWARD_RESULT
 };
 
 /**
@@ -335,6 +361,8 @@ struct raft_message
         struct raft_append_entries_result append_entries_result;
         struct raft_install_snapshot install_snapshot;
         struct raft_timeout_now timeout_now;
+        struct raft_forward forward;
+        struct raft_forward_result forward_result;
     };
 };
 
@@ -514,6 +542,9 @@ struct raft_progress
     raft_index snapshot_index; /* Last index of most recent snapshot sent. */
     raft_time last_send;       /* Timestamp of last AppendEntries RPC. */
     bool recent_recv;          /* A msg was received within election timeout. */
+    raft_time rtt_start;       /* Send time of the RPC being timed, if any. */
+    unsigned srtt;             /* Smoothed round-trip time. */
+    unsigned rttvar;           /* Round-trip time variation. */
 };
 
 struct raft; /* Forward declaration. */
@@ -699,6 +730,43 @@ struct raft
      * being promoted to voter. */
     unsigned max_catch_up_rounds;
     unsigned max_catch_up_round_duration;
+
+    /* If this server is the leader and either a local disk write or the
+     * interval between two ticks takes longer than this many milliseconds,
+     * automatically transfer leadership to a healthy voter. Zero means
+     * disabled. */
+    unsigned stall_threshold;
+    raft_time last_tick;           /* Time at which the last tick fired. */
+    struct raft_transfer *handoff; /* Request used for automatic transfers. */
+    raft_close_cb shutdown_cb;     /* Callback passed to raft_shutdown(). */
+
+    /* If adaptive timeouts are enabled, leaders derive the heartbeat interval
+     * from the round-trip time observed with their followers, and followers
+     * derive the base election timeout from the observed interval between
+     * messages from the leader. The configured heartbeat_timeout and
+     * election_timeout act as upper bounds. */
+    bool adaptive_timeouts;
+    unsigned min_election_timeout;  /* Lower bound of the election timeout. */
+    unsigned min_heartbeat_timeout; /* Lower bound of the heartbeat timeout. */
+    unsigned rtt;                   /* Highest round-trip time estimate. */
+    unsigned contact_interval;      /* Smoothed interval of leader contact. */
+    unsigned contact_jitter;        /* Variation of the contact interval. */
+
+    /* If proposal forwarding is enabled, followers accept raft_apply() requests
+     * and forward them to the current leader. */
+    bool forwarding;
+    void *forwarded[2];      /* Queue of forwarded requests. */
+    raft_term forward_term;  /* Term of the Forward message in flight, or 0. */
+    raft_time forward_start; /* Time the Forward message in flight was sent. */
+
+    /* Heap used for the memory allocated by this instance, or NULL to use the
+     * global one. */
+    struct raft_heap *heap;
+
+    /* Free lists of the control blocks of AppendEntries messages and of leader
+     * and follower disk writes, recycled to avoid allocating them at message
+     * rate. */
+    void *pools[3];
 };
 
 RAFT_API int raft_init(struct raft *r,
@@ -709,6 +777,20 @@ RAFT_API int raft_init(struct raft *r,
 
 RAFT_API void raft_close(struct raft *r, raft_close_cb cb);
 
+/**
+ * Gracefully close a raft instance.
+ *
+ * If this server is the leader, leadership is first transferred to the most
+ * up-to-date voter, and the instance is closed as soon as the new leader is
+ * known or the transfer times out after the election timeout. Otherwise this
+ * is equivalent to raft_close(). While the transfer is in progress new
+ * entries are rejected with #RAFT_NOTLEADER.
+ *
+ * If raft_close() is called while the transfer is in progress, @cb will not be
+ * invoked and only the callback passed to raft_close() will be.
+ */
+RAFT_API void raft_shutdown(struct raft *r, raft_close_cb cb);
+
 /**
  * Bootstrap this raft instance using the given configuration. The instance must
  * not have been started yet and must be completely pristine, otherwise
@@ -778,6 +860,44 @@ RAFT_API void raft_set_snapshot_threshold(struct raft *r, unsigned n);
  */
 RAFT_API void raft_set_pre_vote(struct raft *r, bool enabled);
 
+/**
+ * Enable or disable proposal forwarding. When enabled, raft_apply() can be
+ * called also on followers that know the current leader: the commands are
+ * forwarded to it and the callback fires once they have been committed and
+ * applied locally. Forwarding is turned off by default.
+ */
+RAFT_API void raft_set_forwarding(struct raft *r, bool enabled);
+
+/**
+ * Enable or disable adaptive timeouts. When enabled, the heartbeat interval
+ * tracks the round-trip time observed with the other servers and the election
+ * timeout tracks the observed interval between messages from the leader. Their
+ * values are bounded below by @min_heartbeat_timeout and @min_election_timeout
+ * and above by the configured heartbeat and election timeouts.
+ *
+ * The @min_election_timeout bound must be greater than the heartbeat timeout,
+ * so followers don't start elections while the leader is healthy. Adaptive
+ * timeouts are turned off by default.
+ */
+RAFT_API void raft_set_adaptive_timeouts(struct raft *r,
+                                         bool enabled,
+                                         unsigned min_election_timeout,
+                                         unsigned min_heartbeat_timeout);
+
+/**
+ * Allocate the memory used by this instance from @heap instead of the global
+ * heap set with raft_heap_set(). Passing NULL restores the global heap.
+ *
+ * The heap is in effect while the instance runs its API functions and the
+ * callbacks of its I/O backend, so memory allocated there with raft_malloc()
+ * (for example by FSM callbacks) is charged to it as well. Memory is always
+ * released to the heap it was allocated from, so buffers can be exchanged
+ * freely between instances using different heaps. Since the I/O backend also
+ * allocates memory on behalf of the instance (e.g. entries loaded from disk),
+ * it should normally be configured to use the same heap.
+ */
+RAFT_API void raft_set_heap(struct raft *r, struct raft_heap *heap);
+
 /**
  * Number of outstanding log entries to keep in the log after a snapshot has
  * been taken. This avoids sending snapshots when a follower is behind by just a
@@ -799,6 +919,16 @@ RAFT_API void raft_set_max_catch_up_rounds(struct raft *r, unsigned n);
 RAFT_API void raft_set_max_catch_up_round_duration(struct raft *r,
                                                    unsigned msecs);
 
+/**
+ * Set the maximum latency of a local disk write or of the interval between two
+ * ticks that a leader tolerates before assuming that its disk or its event loop
+ * is stalling. When that happens the leader automatically transfers leadership
+ * to the most up-to-date voter that is keeping up with the commit index, if
+ * any. The value should be greater than the heartbeat timeout. The default is
+ * zero, which disables stall detection.
+ */
+RAFT_API void raft_set_stall_threshold(struct raft *r, unsigned msecs);
+
 /**
  * Return a human-readable description of the last error occurred.
  */
@@ -852,6 +982,11 @@ struct raft_apply
  * own log and attempt to replicate them on other servers by sending
  * AppendEntries RPCs.
  *
+ * If this server is a follower and proposal forwarding is enabled (see
+ * raft_set_forwarding()), the commands are sent to the current leader, which
+ * appends them to its log. The callback fires once the follower has applied
+ * them, or with #RAFT_NOTLEADER if the leader rejected them.
+ *
  * The memory pointed at by the @base attribute of each #raft_buffer in the
  * given array must have been allocated with raft_malloc() or a compatible
  * allocator. If this function returns 0, the ownership of this memory is
@@ -113,6 +113,112 @@ RAFT_API void raft_uv_set_segment_size(struct raft_io *io, size_t size);
  */
 RAFT_API void raft_uv_set_connect_retry_delay(struct raft_io *io, unsigned msecs);
 
+/**
+ * Set how many messages and how many bytes can be kept for a peer while no
+ * connection to it is available.
+ *
+ * When a connection attempt fails and these limits are exceeded, messages
+ * superseded by more recent ones (e.g. older heartbeats and results) are
+ * discarded first, and then the oldest ones. Discarded messages fail with
+ * #RAFT_NOCONNECTION.
+ *
+ * The default is 3 messages and 8 megabytes.
+ */
+RAFT_API void raft_uv_set_send_pending_limit(struct raft_io *io,
+                                             unsigned n,
+                                             size_t size);
+
+/**
+ * Set the maximum number of bytes that can be queued for writing to a single
+ * peer connection before it's considered congested.
+ *
+ * While a connection is congested, sending a message carrying entries or
+ * snapshot data to that peer fails with #RAFT_BUSY. The connection stops being
+ * congested once the queue drains below half of this limit.
+ *
+ * The default is 64 megabytes.
+ */
+RAFT_API void raft_uv_set_send_queue_limit(struct raft_io *io, size_t size);
+
+/**
+ * Limit the rate of bulk traffic, i.e. InstallSnapshot messages and large
+ * AppendEntries messages such as the ones sent to followers catching up.
+ *
+ * The @rate limit applies to each peer and the @global_rate limit to all peers
+ * together, both in bytes per second. Bulk messages exceeding the limits are
+ * delayed, while other messages are never throttled. A value of zero disables
+ * the relevant limit. Limits can be changed at any time.
+ *
+ * The default is no limit.
+ */
+RAFT_API void raft_uv_set_send_rate(struct raft_io *io,
+                                    size_t rate,
+                                    size_t global_rate);
+
+/**
+ * Return how many messages have been delayed by the send rate limits, and the
+ * total number of milliseconds they spent waiting.
+ */
+RAFT_API void raft_uv_throttle_stats(struct raft_io *io,
+                                     unsigned long long *n,
+                                     unsigned long long *msecs);
+
+/**
+ * Enable or disable a dedicated priority connection to each peer.
+ *
+ * When enabled, control messages (votes, heartbeats, results and TimeoutNow)
+ * are sent over a second connection, separate from the one used for messages
+ * carrying entries or snapshots, so they don't queue up behind large payloads.
+ * Control messages might then be delivered before bulk messages sent earlier,
+ * which the raft protocol tolerates.
+ *
+ * The default is disabled.
+ */
+RAFT_API void raft_uv_set_priority_channel(struct raft_io *io, bool enabled);
+
+/**
+ * Enable or disable a dedicated thread for receiving messages.
+ *
+ * When enabled, incoming connections are handed over to a separate thread
+ * running its own event loop as soon as the transport has accepted them. That
+ * thread reads and decodes messages, and passes them back to the loop of the
+ * raft_io instance, where the receive callback is fired as usual. Incoming
+ * connections whose stream is not backed by a TCP socket or a pipe are still
+ * read by the raft_io loop.
+ *
+ * Message memory is allocated by the receiving thread and released by the
+ * raft_io loop, so the allocator set with raft_heap_set() must be thread-safe.
+ *
+ * This must be called before raft_io->start(). The default is disabled.
+ */
+RAFT_API void raft_uv_set_recv_thread(struct raft_io *io, bool enabled);
+
+/**
+ * Keep up to @n of the memory areas used to buffer segment writes, instead of
+ * freeing them when a segment is closed, so they can be reused for the next
+ * segments. At most 8 areas can be kept.
+ *
+ * If @huge_pages is true, buffers spanning at least one huge page are rounded
+ * up to a whole number of huge pages, and the kernel is advised to back them,
+ * as well as large received payloads, with transparent huge pages.
+ *
+ * The default is to keep no area and to not use huge pages.
+ */
+RAFT_API void raft_uv_set_arena_pool(struct raft_io *io,
+                                     unsigned n,
+                                     bool huge_pages);
+
+/**
+ * Allocate the memory used by this backend from @heap instead of the global
+ * heap, see raft_set_heap(). It applies to the work done in the event loop and
+ * in worker threads, such as receiving messages, buffering segment writes and
+ * loading snapshots, while requests submitted by the raft instance allocate
+ * from the heap of the instance. Passing NULL restores the global heap.
+ *
+ * This must be called before raft_io->start().
+ */
+RAFT_API void raft_uv_set_heap(struct raft_io *io, struct raft_heap *heap);
+
 /**
  * Emit low-level debug messages using the given tracer.
  */
@@ -234,4 +340,32 @@ RAFT_API int raft_uv_tcp_init(struct raft_uv_transport *t,
  */
 RAFT_API void raft_uv_tcp_close(struct raft_uv_transport *t);
 
+/**
+ * Socket options for the TCP transport. Zero values leave the relevant system
+ * default untouched.
+ */
+struct raft_uv_tcp_options
+{
+    bool nodelay;                /* Disable Nagle's algorithm (TCP_NODELAY) */
+    bool quickack;               /* Send ACKs immediately (TCP_QUICKACK) */
+    unsigned keepalive;          /* Idle seconds before keepalive probes */
+    unsigned keepalive_interval; /* Seconds between keepalive probes */
+    unsigned keepalive_count;    /* Failed probes before dropping the peer */
+    int send_buffer;             /* Socket send buffer size (SO_SNDBUF) */
+    int recv_buffer;             /* Socket receive buffer size (SO_RCVBUF) */
+    int busy_poll;               /* Busy poll microseconds (SO_BUSY_POLL) */
+};
+
+/**
+ * Set the socket options of the TCP transport.
+ *
+ * The options are applied to all connections established or accepted after
+ * this call, and to the listening socket if the transport is not listening
+ * yet, so this should normally be called before raft_io->init().
+ *
+ * Return #RAFT_INVALID if an option is not supported on this platform.
+ */
+RAFT_API int raft_uv_tcp_set_options(struct raft_uv_transport *t,
+                                     const struct raft_uv_tcp_options *options);
+
 #endif /* RAFT_UV_H */
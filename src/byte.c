@@ -59,6 +59,42 @@ unsigned byteCrc32(const void *buf, const size_t size, const unsigned init)
     return crc;
 }
 
+/* Multiply two polynomials modulo the CRC32 polynomial. */
+static unsigned byteCrc32Multiply(unsigned a, unsigned b)
+{
+    unsigned product = 0;
+    unsigned bit;
+
+    for (bit = 0x80000000; bit != 0; bit >>= 1) {
+        product = (product << 1) ^ (product & 0x80000000 ? 0x04c11db7 : 0);
+        if (b & bit) {
+            product ^= a;
+        }
+    }
+
+    return product;
+}
+
+unsigned byteCrc32Combine(unsigned crc1, unsigned crc2, size_t size2)
+{
+    unsigned power = 0x100; /* x^8, i.e. the effect of one zero byte */
+    unsigned shift = 1;
+
+    /* Since byteCrc32() doesn't invert its input or output, the checksum of
+     * the concatenation is the checksum of the second buffer XOR'ed with the
+     * checksum of the first one shifted by as many zero bytes as the size of
+     * the second one, i.e. multiplied by x^(8 * size2). */
+    while (size2 != 0) {
+        if (size2 & 1) {
+            shift = byteCrc32Multiply(shift, power);
+        }
+        power = byteCrc32Multiply(power, power);
+        size2 >>= 1;
+    }
+
+    return byteCrc32Multiply(crc1, shift) ^ crc2;
+}
+
 /* ================ sha1.c ================ */
 /*
 SHA-1 in C
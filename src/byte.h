@@ -178,6 +178,11 @@ BYTE__INLINE size_t bytePad64(size_t size)
 /* Calculate the CRC32 checksum of the given data buffer. */
 unsigned byteCrc32(const void *buf, size_t size, unsigned init);
 
+/* Return the CRC32 checksum of the concatenation of two data buffers, given the
+ * checksum @crc1 of the first one, the checksum @crc2 of the second one
+ * calculated with a zero initial value, and the size of the second one. */
+unsigned byteCrc32Combine(unsigned crc1, unsigned crc2, size_t size2);
+
 struct byteSha1
 {
     uint32_t state[5];
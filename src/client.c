@@ -2,6 +2,8 @@
 #include "assert.h"
 #include "configuration.h"
 #include "err.h"
+#include "forward.h"
+#include "heap.h"
 #include "log.h"
 #include "membership.h"
 #include "progress.h"
@@ -17,11 +19,11 @@
 #define tracef(...)
 #endif
 
-int raft_apply(struct raft *r,
-               struct raft_apply *req,
-               const struct raft_buffer bufs[],
-               const unsigned n,
-               raft_apply_cb cb)
+static int clientApply(struct raft *r,
+                       struct raft_apply *req,
+                       const struct raft_buffer bufs[],
+                       const unsigned n,
+                       raft_apply_cb cb)
 {
     raft_index index;
     int rv;
@@ -30,6 +32,15 @@ int raft_apply(struct raft *r,
     assert(bufs != NULL);
     assert(n > 0);
 
+    if (r->state == RAFT_FOLLOWER && r->forwarding) {
+        rv = forwardApply(r, req, bufs, n, cb);
+        if (rv != 0) {
+            ErrMsgFromCode(r->errmsg, rv);
+            goto err;
+        }
+        return 0;
+    }
+
     if (r->state != RAFT_LEADER || r->transfer != NULL) {
         rv = RAFT_NOTLEADER;
         ErrMsgFromCode(r->errmsg, rv);
@@ -66,7 +77,21 @@ err:
     return rv;
 }
 
-int raft_barrier(struct raft *r, struct raft_barrier *req, raft_barrier_cb cb)
+int raft_apply(struct raft *r,
+               struct raft_apply *req,
+               const struct raft_buffer bufs[],
+               const unsigned n,
+               raft_apply_cb cb)
+{
+    struct raft_heap *heap = HeapEnter(r->heap);
+    int rv = clientApply(r, req, bufs, n, cb);
+    HeapLeave(heap);
+    return rv;
+}
+
+static int clientBarrier(struct raft *r,
+                         struct raft_barrier *req,
+                         raft_barrier_cb cb)
 {
     raft_index index;
     struct raft_buffer buf;
@@ -116,6 +141,14 @@ err:
     return rv;
 }
 
+int raft_barrier(struct raft *r, struct raft_barrier *req, raft_barrier_cb cb)
+{
+    struct raft_heap *heap = HeapEnter(r->heap);
+    int rv = clientBarrier(r, req, cb);
+    HeapLeave(heap);
+    return rv;
+}
+
 static int clientChangeConfiguration(
     struct raft *r,
     struct raft_change *req,
@@ -168,11 +201,11 @@ err:
     return rv;
 }
 
-int raft_add(struct raft *r,
-             struct raft_change *req,
-             raft_id id,
-             const char *address,
-             raft_change_cb cb)
+static int clientAdd(struct raft *r,
+                     struct raft_change *req,
+                     raft_id id,
+                     const char *address,
+                     raft_change_cb cb)
 {
     struct raft_configuration configuration;
     int rv;
@@ -215,11 +248,23 @@ err:
     return rv;
 }
 
-int raft_assign(struct raft *r,
-                struct raft_change *req,
-                raft_id id,
-                int role,
-                raft_change_cb cb)
+int raft_add(struct raft *r,
+             struct raft_change *req,
+             raft_id id,
+             const char *address,
+             raft_change_cb cb)
+{
+    struct raft_heap *heap = HeapEnter(r->heap);
+    int rv = clientAdd(r, req, id, address, cb);
+    HeapLeave(heap);
+    return rv;
+}
+
+static int clientAssign(struct raft *r,
+                        struct raft_change *req,
+                        raft_id id,
+                        int role,
+                        raft_change_cb cb)
 {
     const struct raft_server *server;
     unsigned server_index;
@@ -316,10 +361,22 @@ err:
     return rv;
 }
 
-int raft_remove(struct raft *r,
+int raft_assign(struct raft *r,
                 struct raft_change *req,
                 raft_id id,
+                int role,
                 raft_change_cb cb)
+{
+    struct raft_heap *heap = HeapEnter(r->heap);
+    int rv = clientAssign(r, req, id, role, cb);
+    HeapLeave(heap);
+    return rv;
+}
+
+static int clientRemove(struct raft *r,
+                        struct raft_change *req,
+                        raft_id id,
+                        raft_change_cb cb)
 {
     const struct raft_server *server;
     struct raft_configuration configuration;
@@ -370,6 +427,17 @@ err:
     return rv;
 }
 
+int raft_remove(struct raft *r,
+                struct raft_change *req,
+                raft_id id,
+                raft_change_cb cb)
+{
+    struct raft_heap *heap = HeapEnter(r->heap);
+    int rv = clientRemove(r, req, id, cb);
+    HeapLeave(heap);
+    return rv;
+}
+
 /* Find a suitable voting follower. */
 static raft_id clientSelectTransferee(struct raft *r)
 {
@@ -394,10 +462,10 @@ static raft_id clientSelectTransferee(struct raft *r)
     return 0;
 }
 
-int raft_transfer(struct raft *r,
-                  struct raft_transfer *req,
-                  raft_id id,
-                  raft_transfer_cb cb)
+static int clientTransfer(struct raft *r,
+                          struct raft_transfer *req,
+                          raft_id id,
+                          raft_transfer_cb cb)
 {
     const struct raft_server *server;
     unsigned i;
@@ -447,4 +515,15 @@ err:
     return rv;
 }
 
+int raft_transfer(struct raft *r,
+                  struct raft_transfer *req,
+                  raft_id id,
+                  raft_transfer_cb cb)
+{
+    struct raft_heap *heap = HeapEnter(r->heap);
+    int rv = clientTransfer(r, req, id, cb);
+    HeapLeave(heap);
+    return rv;
+}
+
 #undef tracef
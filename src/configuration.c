@@ -6,10 +6,26 @@
 /* Current encoding format version. */
 #define ENCODING_FORMAT 1
 
+/* Configurations with fewer servers than this are scanned linearly, which is
+ * faster than hashing for small arrays. */
+#define INDEX_MIN_SERVERS 16
+
 void configurationInit(struct raft_configuration *c)
 {
     c->servers = NULL;
     c->n = 0;
+    c->index = NULL;
+    c->index_size = 0;
+}
+
+/* Release the hash index of the given configuration, if any. */
+static void indexDrop(struct raft_configuration *c)
+{
+    if (c->index != NULL) {
+        raft_free(c->index);
+    }
+    c->index = NULL;
+    c->index_size = 0;
 }
 
 void configurationClose(struct raft_configuration *c)
@@ -23,6 +39,55 @@ void configurationClose(struct raft_configuration *c)
     if (c->servers != NULL) {
         raft_free(c->servers);
     }
+    indexDrop(c);
+}
+
+/* Return the first index slot to probe for the given server ID. */
+static unsigned indexSlot(const struct raft_configuration *c, raft_id id)
+{
+    return (unsigned)((id * 0x9E3779B97F4A7C15ULL) >> 32) &
+           (c->index_size - 1);
+}
+
+/* Insert the i'th server into the index, using linear probing. Each slot holds
+ * the position of a server in the servers array plus one, or zero if free. */
+static void indexInsert(struct raft_configuration *c, unsigned i)
+{
+    unsigned slot = indexSlot(c, c->servers[i].id);
+    while (c->index[slot] != 0) {
+        slot = (slot + 1) & (c->index_size - 1);
+    }
+    c->index[slot] = i + 1;
+}
+
+/* Rebuild the hash index from scratch, making it at least twice as large as the
+ * number of servers. If the configuration is small or memory can't be
+ * allocated, just drop the index and fall back to linear scans. */
+static void indexRebuild(struct raft_configuration *c)
+{
+    unsigned size = INDEX_MIN_SERVERS * 2;
+    unsigned i;
+
+    if (c->n < INDEX_MIN_SERVERS) {
+        indexDrop(c);
+        return;
+    }
+
+    while (size < c->n * 2) {
+        size *= 2;
+    }
+    if (size != c->index_size) {
+        indexDrop(c);
+        c->index = raft_malloc(size * sizeof *c->index);
+        if (c->index == NULL) {
+            return;
+        }
+        c->index_size = size;
+    }
+    memset(c->index, 0, size * sizeof *c->index);
+    for (i = 0; i < c->n; i++) {
+        indexInsert(c, i);
+    }
 }
 
 unsigned configurationIndexOf(const struct raft_configuration *c,
@@ -30,6 +95,17 @@ unsigned configurationIndexOf(const struct raft_configuration *c,
 {
     unsigned i;
     assert(c != NULL);
+    if (c->index != NULL) {
+        unsigned slot = indexSlot(c, id);
+        while (c->index[slot] != 0) {
+            i = c->index[slot] - 1;
+            if (c->servers[i].id == id) {
+                return i;
+            }
+            slot = (slot + 1) & (c->index_size - 1);
+        }
+        return c->n;
+    }
     for (i = 0; i < c->n; i++) {
         if (c->servers[i].id == id) {
             return i;
@@ -125,11 +201,11 @@ int configurationAdd(struct raft_configuration *c,
     }
 
     /* Check that neither the given id or address is already in use */
+    if (configurationIndexOf(c, id) != c->n) {
+        return RAFT_DUPLICATEID;
+    }
     for (i = 0; i < c->n; i++) {
         server = &c->servers[i];
-        if (server->id == id) {
-            return RAFT_DUPLICATEID;
-        }
         if (strcmp(server->address, address) == 0) {
             return RAFT_DUPLICATEADDRESS;
         }
@@ -154,6 +230,13 @@ int configurationAdd(struct raft_configuration *c,
 
     c->n++;
 
+    /* Keep the index at most half full. */
+    if (c->index != NULL && c->n * 2 <= c->index_size) {
+        indexInsert(c, c->n - 1);
+    } else {
+        indexRebuild(c);
+    }
+
     return 0;
 }
 
@@ -177,6 +260,7 @@ int configurationRemove(struct raft_configuration *c, const raft_id id)
         raft_free(c->servers);
         c->n = 0;
         c->servers = NULL;
+        indexDrop(c);
         return 0;
     }
 
@@ -206,6 +290,9 @@ int configurationRemove(struct raft_configuration *c, const raft_id id)
     c->servers = servers;
     c->n--;
 
+    /* Positions after the removed server have shifted. */
+    indexRebuild(c);
+
     return 0;
 }
 
@@ -3,6 +3,7 @@
 #include "assert.h"
 #include "configuration.h"
 #include "election.h"
+#include "forward.h"
 #include "log.h"
 #include "membership.h"
 #include "progress.h"
@@ -37,6 +38,7 @@ static void convertSetState(struct raft *r, unsigned short new_state)
 /* Clear follower state. */
 static void convertClearFollower(struct raft *r)
 {
+    forwardFailAll(r, RAFT_LEADERSHIPLOST);
     r->follower_state.current_leader.id = 0;
     if (r->follower_state.current_leader.address != NULL) {
         raft_free(r->follower_state.current_leader.address);
@@ -214,6 +216,10 @@ void convertToUnavailable(struct raft *r)
     /* Abort any pending leadership transfer request. */
     if (r->transfer != NULL) {
         membershipLeadershipTransferClose(r);
+        /* The callback of a raft_shutdown() transfer closes the instance. */
+        if (r->state == RAFT_UNAVAILABLE) {
+            return;
+        }
     }
     convertClear(r);
     convertSetState(r, RAFT_UNAVAILABLE);
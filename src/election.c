@@ -4,6 +4,7 @@
 #include "configuration.h"
 #include "heap.h"
 #include "log.h"
+#include "rtt.h"
 #include "tracing.h"
 
 /* Set to 1 to enable tracing. */
@@ -35,17 +36,55 @@ struct followerOrCandidateState *getFollowerOrCandidateState(struct raft *r)
     return state;
 }
 
+/* Return the base election timeout, which is derived from the observed leader
+ * contact interval if adaptive timeouts are enabled. */
+static unsigned electionTimeout(struct raft *r)
+{
+    unsigned timeout;
+
+    if (!r->adaptive_timeouts || r->contact_interval == 0) {
+        return r->election_timeout;
+    }
+
+    /* Tolerate a few missed heartbeats before starting an election. */
+    timeout = 5 * rttUpperBound(r->contact_interval, r->contact_jitter);
+    if (timeout < r->min_election_timeout) {
+        timeout = r->min_election_timeout;
+    }
+    if (timeout > r->election_timeout) {
+        timeout = r->election_timeout;
+    }
+
+    return timeout;
+}
+
 void electionResetTimer(struct raft *r)
 {
     struct followerOrCandidateState *state = getFollowerOrCandidateState(r);
+    unsigned base = electionTimeout(r);
     unsigned timeout = (unsigned)r->io->random(r->io, (int)r->election_timeout,
                                                2 * (int)r->election_timeout);
     assert(timeout >= r->election_timeout);
     assert(timeout <= r->election_timeout * 2);
+    /* Scale the randomized value down to the adaptive base timeout. */
+    if (base < r->election_timeout) {
+        timeout = (unsigned)((raft_time)timeout * base / r->election_timeout);
+    }
     state->randomized_election_timeout = timeout;
     r->election_timer_start = r->io->time(r->io);
 }
 
+void electionUpdateContactInterval(struct raft *r)
+{
+    raft_time now = r->io->time(r->io);
+    assert(r->state == RAFT_FOLLOWER);
+    if (!r->adaptive_timeouts) {
+        return;
+    }
+    rttUpdate(&r->contact_interval, &r->contact_jitter,
+              (unsigned)(now - r->election_timer_start));
+}
+
 bool electionTimerExpired(struct raft *r)
 {
     struct followerOrCandidateState *state = getFollowerOrCandidateState(r);
@@ -6,7 +6,9 @@
 #include "../include/raft.h"
 
 /* Reset the election_timer clock and set randomized_election_timeout to a
- * random value between election_timeout and 2 * election_timeout.
+ * random value between election_timeout and 2 * election_timeout. If adaptive
+ * timeouts are enabled, the adaptive base timeout is used in place of
+ * election_timeout.
  *
  * From Section 3.4:
  *
@@ -32,6 +34,13 @@
  * Must be called in follower or candidate state. */
 void electionResetTimer(struct raft *r);
 
+/* Update the estimate of the interval between two consecutive messages from
+ * the current leader, using the time elapsed since the election timer was last
+ * reset. Must be called by followers when receiving a message from the current
+ * leader, before resetting the timer. No-op if adaptive timeouts are
+ * disabled. */
+void electionUpdateContactInterval(struct raft *r);
+
 /* Return true if the election timer has expired.
  *
  * Must be called in follower or candidate state. */
@@ -27,7 +27,7 @@
 #define DISK_LATENCY 10
 
 /* To keep in sync with raft.h */
-#define N_MESSAGE_TYPES 5
+#define N_MESSAGE_TYPES 8
 
 /* Maximum number of peer stub instances connected to a certain stub
  * instance. This should be enough for testing purposes. */
@@ -135,6 +135,7 @@ struct io
     unsigned randomized_election_timeout; /* Value returned by io->random() */
     unsigned network_latency;             /* Milliseconds to deliver RPCs */
     unsigned disk_latency;                /* Milliseconds to perform disk I/O */
+    bool closed;                          /* Whether io->close() was called */
 
     struct
     {
@@ -304,6 +305,16 @@ static void copyAppendEntries(const struct raft_append_entries *src,
     dst->n_entries = src->n_entries;
 }
 
+/* Copy the dynamically allocated memory of a Forward message. */
+static void copyForward(const struct raft_forward *src,
+                        struct raft_forward *dst)
+{
+    int rv;
+    rv = entryBatchCopy(src->entries, &dst->entries, src->n_entries);
+    assert(rv == 0);
+    dst->n_entries = src->n_entries;
+}
+
 /* Copy the dynamically allocated memory of an InstallSnapshot message. */
 static void copyInstallSnapshot(const struct raft_install_snapshot *src,
                                 struct raft_install_snapshot *dst)
@@ -353,10 +364,13 @@ static void ioFlushSend(struct io *io, struct send *send)
         case RAFT_IO_INSTALL_SNAPSHOT:
             copyInstallSnapshot(&src->install_snapshot, &dst->install_snapshot);
             break;
+        case RAFT_IO_FORWARD:
+            copyForward(&src->forward, &dst->forward);
+            break;
     }
 
     /* tracef("io: flush: %s", describeMessage(&send->message)); */
-    io->n_send[send->message.type]++;
+    io->n_send[send->message.type - 1]++;
     status = 0;
 
 out:
@@ -383,6 +397,12 @@ static void ioDestroyTransmit(struct transmit *transmit)
             raft_configuration_close(&message->install_snapshot.conf);
             raft_free(message->install_snapshot.data.base);
             break;
+        case RAFT_IO_FORWARD:
+            if (message->forward.entries != NULL) {
+                raft_free(message->forward.entries[0].batch);
+                raft_free(message->forward.entries);
+            }
+            break;
     }
     raft_free(transmit);
 }
@@ -422,6 +442,8 @@ static void ioFlushAll(struct io *io)
 
 static void ioMethodClose(struct raft_io *raft_io, raft_io_close_cb cb)
 {
+    struct io *io = raft_io->impl;
+    io->closed = true;
     if (cb != NULL) {
         cb(raft_io);
     }
@@ -724,7 +746,7 @@ static void ioReceive(struct io *io, struct raft_message *message)
     /* tracef("io: recv: %s from server %d", describeMessage(message),
        message->server_id); */
     io->recv_cb(io->io, message);
-    io->n_recv[message->type]++;
+    io->n_recv[message->type - 1]++;
 }
 
 static void ioDeliverTransmit(struct io *io, struct transmit *transmit)
@@ -852,6 +874,7 @@ static int ioInit(struct raft_io *raft_io, unsigned index, raft_time *time)
     io->randomized_election_timeout = ELECTION_TIMEOUT + index * 100;
     io->network_latency = NETWORK_LATENCY;
     io->disk_latency = DISK_LATENCY;
+    io->closed = false;
     io->fault.countdown = -1;
     io->fault.n = -1;
     memset(io->drop, 0, sizeof io->drop);
@@ -933,7 +956,11 @@ static int serverInit(struct raft_fixture *f, unsigned i, struct raft_fsm *fsm)
 
 static void serverClose(struct raft_fixture_server *s)
 {
-    raft_close(&s->raft, NULL);
+    struct io *io = s->io.impl;
+    /* The raft instance might have been closed already by the test. */
+    if (!io->closed) {
+        raft_close(&s->raft, NULL);
+    }
     ioClose(&s->io);
 }
 
@@ -1870,13 +1897,13 @@ void raft_fixture_io_fault(struct raft_fixture *f,
 unsigned raft_fixture_n_send(struct raft_fixture *f, unsigned i, int type)
 {
     struct io *io = f->servers[i].io.impl;
-    return io->n_send[type];
+    return io->n_send[type - 1];
 }
 
 unsigned raft_fixture_n_recv(struct raft_fixture *f, unsigned i, int type)
 {
     struct io *io = f->servers[i].io.impl;
-    return io->n_recv[type];
+    return io->n_recv[type - 1];
 }
 
 #undef tracef
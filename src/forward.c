@@ -0,0 +1,367 @@
+#include "forward.h"
+
+#include <string.h>
+
+#include "assert.h"
+#include "heap.h"
+#include "queue.h"
+#include "tracing.h"
+
+/* Set to 1 to enable tracing. */
+#if 0
+#define tracef(...) Tracef(r->tracer, __VA_ARGS__)
+#else
+#define tracef(...)
+#endif
+
+/* Possible states of a forwarded request. */
+enum {
+    FORWARD__PENDING = 0, /* Waiting to be sent to the leader. */
+    FORWARD__SENT,        /* Sent to the leader, waiting for the result. */
+    FORWARD__ASSIGNED     /* Appended by the leader, waiting to be applied. */
+};
+
+/* A raft_apply() request submitted to a follower. */
+struct forwardRequest
+{
+    struct raft_apply *req;   /* User request. */
+    struct raft_buffer *bufs; /* Commands, until they are sent. */
+    unsigned n;               /* Number of commands. */
+    int state;                /* Pending, sent or assigned. */
+    queue queue;              /* Link in the forwarded requests queue. */
+};
+
+/* Context of a RAFT_IO_FORWARD message that was submitted with
+ * raft_io->send(). */
+struct forwardSend
+{
+    struct raft *raft;          /* Instance sending the commands. */
+    raft_term term;             /* Term the message was sent at. */
+    struct raft_entry *entries; /* Commands being sent. */
+    unsigned n;                 /* Length of the entries array. */
+    struct raft_io_send send;   /* Underlying I/O send request. */
+};
+
+/* Remove a forwarded request from the queue and fire its callback. */
+static void forwardFinish(struct forwardRequest *f, int status, void *result)
+{
+    struct raft_apply *req = f->req;
+    unsigned i;
+    QUEUE_REMOVE(&f->queue);
+    if (f->bufs != NULL) {
+        for (i = 0; i < f->n; i++) {
+            raft_free(f->bufs[i].base);
+        }
+        raft_free(f->bufs);
+    }
+    raft_free(f);
+    if (req->cb != NULL) {
+        req->cb(req, status, result);
+    }
+}
+
+/* Fail all forwarded requests in the given state. */
+static void forwardFailState(struct raft *r, int state, int status)
+{
+    queue *head = QUEUE_HEAD(&r->forwarded);
+    while (head != &r->forwarded) {
+        struct forwardRequest *f;
+        f = QUEUE_DATA(head, struct forwardRequest, queue);
+        head = QUEUE_NEXT(head);
+        if (f->state == state) {
+            forwardFinish(f, status, NULL);
+        }
+    }
+}
+
+int forwardApply(struct raft *r,
+                 struct raft_apply *req,
+                 const struct raft_buffer bufs[],
+                 unsigned n,
+                 raft_apply_cb cb)
+{
+    struct forwardRequest *f;
+    int rv;
+
+    assert(r->state == RAFT_FOLLOWER);
+    assert(r->forwarding);
+
+    if (r->follower_state.current_leader.id == 0) {
+        rv = RAFT_NOTLEADER;
+        goto err;
+    }
+
+    f = raft_malloc(sizeof *f);
+    if (f == NULL) {
+        rv = RAFT_NOMEM;
+        goto err;
+    }
+    f->bufs = raft_malloc(n * sizeof *f->bufs);
+    if (f->bufs == NULL) {
+        rv = RAFT_NOMEM;
+        goto err_after_alloc;
+    }
+    memcpy(f->bufs, bufs, n * sizeof *f->bufs);
+    f->n = n;
+    f->state = FORWARD__PENDING;
+    f->req = req;
+
+    req->type = RAFT_COMMAND;
+    req->index = 0;
+    req->cb = cb;
+
+    QUEUE_PUSH(&r->forwarded, &f->queue);
+
+    rv = forwardFlush(r);
+    if (rv != 0) {
+        goto err_after_push;
+    }
+
+    return 0;
+
+err_after_push:
+    QUEUE_REMOVE(&f->queue);
+    raft_free(f->bufs);
+err_after_alloc:
+    raft_free(f);
+err:
+    assert(rv != 0);
+    return rv;
+}
+
+static void forwardSendCb(struct raft_io_send *send, int status)
+{
+    struct forwardSend *s = send->data;
+    struct raft *r = s->raft;
+    struct raft_heap *heap = HeapEnter(r->heap);
+    unsigned i;
+
+    for (i = 0; i < s->n; i++) {
+        raft_free(s->entries[i].buf.base);
+    }
+    raft_free(s->entries);
+
+    if (status != 0 && r->state == RAFT_FOLLOWER &&
+        r->forward_term == s->term) {
+        tracef("failed to forward commands: %s", raft_strerror(status));
+        forwardAbort(r);
+    }
+
+    raft_free(s);
+    HeapLeave(heap);
+}
+
+int forwardFlush(struct raft *r)
+{
+    struct raft_message message;
+    struct forwardSend *s;
+    struct forwardRequest *f;
+    queue *head;
+    unsigned n = 0;
+    unsigned i;
+    int rv;
+
+    assert(r->state == RAFT_FOLLOWER);
+
+    if (r->forward_term != 0 || r->follower_state.current_leader.id == 0) {
+        return 0;
+    }
+
+    QUEUE_FOREACH(head, &r->forwarded)
+    {
+        f = QUEUE_DATA(head, struct forwardRequest, queue);
+        if (f->state == FORWARD__PENDING) {
+            n += f->n;
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    s = raft_malloc(sizeof *s);
+    if (s == NULL) {
+        rv = RAFT_NOMEM;
+        goto err;
+    }
+    s->entries = raft_calloc(n, sizeof *s->entries);
+    if (s->entries == NULL) {
+        rv = RAFT_NOMEM;
+        goto err_after_alloc;
+    }
+    s->n = n;
+    s->raft = r;
+    s->term = r->current_term;
+
+    n = 0;
+    QUEUE_FOREACH(head, &r->forwarded)
+    {
+        f = QUEUE_DATA(head, struct forwardRequest, queue);
+        if (f->state != FORWARD__PENDING) {
+            continue;
+        }
+        for (i = 0; i < f->n; i++) {
+            struct raft_entry *entry = &s->entries[n++];
+            entry->term = r->current_term;
+            entry->type = RAFT_COMMAND;
+            entry->buf = f->bufs[i];
+            entry->batch = NULL;
+        }
+    }
+
+    message.type = RAFT_IO_FORWARD;
+    message.server_id = r->follower_state.current_leader.id;
+    message.server_address = r->follower_state.current_leader.address;
+    message.forward.term = r->current_term;
+    message.forward.entries = s->entries;
+    message.forward.n_entries = s->n;
+
+    tracef("forward %u commands to server %llu", s->n, message.server_id);
+
+    s->send.data = s;
+    rv = r->io->send(r->io, &s->send, &message, forwardSendCb);
+    if (rv != 0) {
+        goto err_after_entries_alloc;
+    }
+
+    /* The memory of the commands is now owned by the send request. */
+    QUEUE_FOREACH(head, &r->forwarded)
+    {
+        f = QUEUE_DATA(head, struct forwardRequest, queue);
+        if (f->state == FORWARD__PENDING) {
+            raft_free(f->bufs);
+            f->bufs = NULL;
+            f->state = FORWARD__SENT;
+        }
+    }
+
+    r->forward_term = r->current_term;
+    r->forward_start = r->io->time(r->io);
+
+    return 0;
+
+err_after_entries_alloc:
+    raft_free(s->entries);
+err_after_alloc:
+    raft_free(s);
+err:
+    assert(rv != 0);
+    return rv;
+}
+
+void forwardResult(struct raft *r,
+                   raft_id id,
+                   const struct raft_forward_result *result)
+{
+    raft_index index = result->index;
+    queue *head;
+
+    if (r->state != RAFT_FOLLOWER || r->forward_term == 0 ||
+        r->forward_term != result->term ||
+        r->follower_state.current_leader.id != id) {
+        tracef("stale forward result -> ignore");
+        return;
+    }
+
+    r->forward_term = 0;
+
+    head = QUEUE_HEAD(&r->forwarded);
+    while (head != &r->forwarded) {
+        struct forwardRequest *f;
+        f = QUEUE_DATA(head, struct forwardRequest, queue);
+        head = QUEUE_NEXT(head);
+        if (f->state != FORWARD__SENT) {
+            continue;
+        }
+        if (index == 0) {
+            forwardFinish(f, RAFT_NOTLEADER, NULL);
+            continue;
+        }
+        /* The leader sends the result before the commit index covering these
+         * entries, so they can't have been applied yet. */
+        if (index <= r->last_applied) {
+            forwardFinish(f, RAFT_LEADERSHIPLOST, NULL);
+        } else {
+            f->req->index = index;
+            f->state = FORWARD__ASSIGNED;
+        }
+        index += f->n;
+    }
+
+    /* Errors will be retried at the next tick. */
+    forwardFlush(r);
+}
+
+void forwardApplied(struct raft *r, raft_index index, void *result)
+{
+    queue *head;
+    QUEUE_FOREACH(head, &r->forwarded)
+    {
+        struct forwardRequest *f;
+        f = QUEUE_DATA(head, struct forwardRequest, queue);
+        if (f->state == FORWARD__ASSIGNED && f->req->index == index) {
+            forwardFinish(f, 0, result);
+            return;
+        }
+    }
+}
+
+void forwardTruncate(struct raft *r, raft_index index)
+{
+    queue *head = QUEUE_HEAD(&r->forwarded);
+    while (head != &r->forwarded) {
+        struct forwardRequest *f;
+        f = QUEUE_DATA(head, struct forwardRequest, queue);
+        head = QUEUE_NEXT(head);
+        if (f->state == FORWARD__ASSIGNED && f->req->index + f->n > index) {
+            forwardFinish(f, RAFT_LEADERSHIPLOST, NULL);
+        }
+    }
+}
+
+void forwardAbort(struct raft *r)
+{
+    if (r->forward_term == 0) {
+        return;
+    }
+    r->forward_term = 0;
+    forwardFailState(r, FORWARD__SENT, RAFT_LEADERSHIPLOST);
+    forwardFlush(r);
+}
+
+void forwardFailAll(struct raft *r, int status)
+{
+    queue pending;
+    queue *head;
+
+    r->forward_term = 0;
+
+    /* Move all requests to a separate queue first, so requests submitted by
+     * the callbacks are not affected. */
+    QUEUE_INIT(&pending);
+    while (!QUEUE_IS_EMPTY(&r->forwarded)) {
+        head = QUEUE_HEAD(&r->forwarded);
+        QUEUE_REMOVE(head);
+        QUEUE_PUSH(&pending, head);
+    }
+    while (!QUEUE_IS_EMPTY(&pending)) {
+        head = QUEUE_HEAD(&pending);
+        forwardFinish(QUEUE_DATA(head, struct forwardRequest, queue), status,
+                      NULL);
+    }
+}
+
+void forwardTick(struct raft *r)
+{
+    raft_time now = r->io->time(r->io);
+    assert(r->state == RAFT_FOLLOWER);
+    if (r->forward_term == 0) {
+        forwardFlush(r);
+        return;
+    }
+    if (now - r->forward_start >= r->election_timeout) {
+        tracef("forward result not received -> abort");
+        forwardAbort(r);
+    }
+}
+
+#undef tracef
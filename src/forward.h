@@ -0,0 +1,48 @@
+/* Forwarding of client proposals from followers to the leader. */
+
+#ifndef FORWARD_H_
+#define FORWARD_H_
+
+#include "../include/raft.h"
+
+/* Submit the given commands to the current leader on behalf of a follower.
+ *
+ * The commands are queued and sent to the leader in a single Forward message
+ * together with any other command submitted while the previous Forward message
+ * is still in flight. */
+int forwardApply(struct raft *r,
+                 struct raft_apply *req,
+                 const struct raft_buffer bufs[],
+                 unsigned n,
+                 raft_apply_cb cb);
+
+/* Send a Forward message with all queued commands to the current leader, unless
+ * another Forward message is still in flight. */
+int forwardFlush(struct raft *r);
+
+/* Handle the result of the Forward message in flight, assigning log indexes to
+ * the requests it contained. */
+void forwardResult(struct raft *r,
+                   raft_id id,
+                   const struct raft_forward_result *result);
+
+/* Fire the callback of the forwarded request whose first entry has the given
+ * index, if any. To be called by followers after applying a command. */
+void forwardApplied(struct raft *r, raft_index index, void *result);
+
+/* Fail all forwarded requests whose entries start at the given index or later,
+ * since they were discarded from the log. */
+void forwardTruncate(struct raft *r, raft_index index);
+
+/* Fail the requests of the Forward message in flight, since the leader changed
+ * or didn't reply in time, and re-send the queued ones. */
+void forwardAbort(struct raft *r);
+
+/* Fail all forwarded requests with the given status. */
+void forwardFailAll(struct raft *r, int status);
+
+/* Abort the Forward message in flight if the leader hasn't replied within an
+ * election timeout. To be called by followers at every tick. */
+void forwardTick(struct raft *r);
+
+#endif /* FORWARD_H_ */
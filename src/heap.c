@@ -1,8 +1,11 @@
 #include "heap.h"
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../include/raft.h"
+#include "assert.h"
 
 static void *defaultMalloc(void *data, size_t size)
 {
@@ -52,27 +55,128 @@ static struct raft_heap defaultHeap = {
 
 static struct raft_heap *currentHeap = &defaultHeap;
 
+/* Heap selected by the innermost HeapEnter() call of the running thread, or
+ * NULL if the global one should be used. */
+static _Thread_local struct raft_heap *scopeHeap = NULL;
+
+/* Header stored right before the memory returned to callers, recording the
+ * heap that allocated it, so that memory can be released by a different
+ * instance (or after the global heap has changed) and still be returned to its
+ * owner. */
+struct heapHeader
+{
+    struct raft_heap *heap; /* Heap that owns the block. */
+    size_t alignment;       /* Alignment of aligned blocks, or 0. */
+};
+
+/* Space reserved for the header in front of regular blocks. It's a multiple of
+ * the strictest fundamental alignment, so the returned memory keeps the
+ * alignment guaranteed by malloc(). */
+#define HEADER_SIZE                                                     \
+    ((sizeof(struct heapHeader) + _Alignof(max_align_t) - 1) /          \
+     _Alignof(max_align_t) * _Alignof(max_align_t))
+
+static struct raft_heap *heapSelect(void)
+{
+    return scopeHeap != NULL ? scopeHeap : currentHeap;
+}
+
+/* Return the offset of the memory returned to callers from the start of the
+ * underlying block. */
+static size_t heapPadding(size_t alignment)
+{
+    /* Alignments are powers of two, so the header size is a multiple of any
+     * alignment smaller than it. */
+    return alignment > HEADER_SIZE ? alignment : HEADER_SIZE;
+}
+
+static void *heapAttach(struct raft_heap *heap, size_t alignment, void *block)
+{
+    struct heapHeader header;
+    char *ptr;
+    if (block == NULL) {
+        return NULL;
+    }
+    ptr = (char *)block + heapPadding(alignment);
+    header.heap = heap;
+    header.alignment = alignment;
+    memcpy(ptr - sizeof header, &header, sizeof header);
+    return ptr;
+}
+
+static void *heapBlock(void *ptr, struct heapHeader *header)
+{
+    memcpy(header, (char *)ptr - sizeof *header, sizeof *header);
+    return (char *)ptr - heapPadding(header->alignment);
+}
+
+struct raft_heap *HeapEnter(struct raft_heap *heap)
+{
+    struct raft_heap *prev = scopeHeap;
+    scopeHeap = heap;
+    return prev;
+}
+
+void HeapLeave(struct raft_heap *prev)
+{
+    scopeHeap = prev;
+}
+
 void *HeapMalloc(size_t size)
 {
-    return currentHeap->malloc(currentHeap->data, size);
+    struct raft_heap *heap = heapSelect();
+    if (size > SIZE_MAX - HEADER_SIZE) {
+        return NULL;
+    }
+    return heapAttach(heap, 0, heap->malloc(heap->data, HEADER_SIZE + size));
 }
 
 void HeapFree(void *ptr)
 {
+    struct heapHeader header;
+    struct raft_heap *heap;
+    void *block;
     if (ptr == NULL) {
         return;
     }
-    currentHeap->free(currentHeap->data, ptr);
+    block = heapBlock(ptr, &header);
+    heap = header.heap;
+    if (header.alignment != 0) {
+        heap->aligned_free(heap->data, header.alignment, block);
+    } else {
+        heap->free(heap->data, block);
+    }
 }
 
 void *HeapCalloc(size_t nmemb, size_t size)
 {
-    return currentHeap->calloc(currentHeap->data, nmemb, size);
+    struct raft_heap *heap = heapSelect();
+    if (size != 0 && nmemb > (SIZE_MAX - HEADER_SIZE) / size) {
+        return NULL;
+    }
+    return heapAttach(
+        heap, 0, heap->calloc(heap->data, 1, HEADER_SIZE + nmemb * size));
 }
 
 void *HeapRealloc(void *ptr, size_t size)
 {
-    return currentHeap->realloc(currentHeap->data, ptr, size);
+    struct heapHeader header;
+    void *block;
+    if (ptr == NULL) {
+        return HeapMalloc(size);
+    }
+    if (size == 0) {
+        HeapFree(ptr);
+        return NULL;
+    }
+    if (size > SIZE_MAX - HEADER_SIZE) {
+        return NULL;
+    }
+    /* Grow or shrink the block within the heap that owns it. */
+    block = heapBlock(ptr, &header);
+    assert(header.alignment == 0);
+    block = header.heap->realloc(header.heap->data, block, HEADER_SIZE + size);
+    return heapAttach(header.heap, 0, block);
 }
 
 void *raft_malloc(size_t size)
@@ -97,12 +201,20 @@ void *raft_realloc(void *ptr, size_t size)
 
 void *raft_aligned_alloc(size_t alignment, size_t size)
 {
-    return currentHeap->aligned_alloc(currentHeap->data, alignment, size);
+    struct raft_heap *heap = heapSelect();
+    size_t padding = heapPadding(alignment);
+    void *block;
+    if (size > SIZE_MAX - padding) {
+        return NULL;
+    }
+    block = heap->aligned_alloc(heap->data, alignment, padding + size);
+    return heapAttach(heap, alignment, block);
 }
 
 void raft_aligned_free(size_t alignment, void *ptr)
 {
-    currentHeap->aligned_free(currentHeap->data, alignment, ptr);
+    (void)alignment;
+    HeapFree(ptr);
 }
 
 void raft_heap_set(struct raft_heap *heap)
@@ -5,6 +5,17 @@
 
 #include <stddef.h>
 
+struct raft_heap;
+
+/* Make allocations performed by the calling thread use the given heap, or the
+ * global one if @heap is NULL, until HeapLeave() is called with the returned
+ * value. Scopes can be nested. Memory is always released to the heap that
+ * allocated it, regardless of the scope that is active at that point. */
+struct raft_heap *HeapEnter(struct raft_heap *heap);
+
+/* Restore the heap that was in use before the matching HeapEnter() call. */
+void HeapLeave(struct raft_heap *prev);
+
 void *HeapMalloc(size_t size);
 
 void *HeapCalloc(size_t nmemb, size_t size);
@@ -6,6 +6,14 @@
 #include "err.h"
 #include "log.h"
 #include "progress.h"
+#include "tracing.h"
+
+/* Set to 1 to enable tracing. */
+#if 0
+#define tracef(...) Tracef(r->tracer, __VA_ARGS__)
+#else
+#define tracef(...)
+#endif
 
 int membershipCanChangeConfiguration(struct raft *r)
 {
@@ -195,6 +203,82 @@ int membershipLeadershipTransferStart(struct raft *r)
     return 0;
 }
 
+/* Find the most up-to-date voting follower to hand leadership off to. If
+ * @healthy is true, only consider followers that keep up with the commit
+ * index. */
+static raft_id membershipSelectHandoffTarget(struct raft *r, bool healthy)
+{
+    raft_id id = 0;
+    raft_index best = 0;
+    unsigned i;
+
+    for (i = 0; i < r->configuration.n; i++) {
+        const struct raft_server *server = &r->configuration.servers[i];
+        raft_index match_index;
+        if (server->id == r->id || server->role != RAFT_VOTER) {
+            continue;
+        }
+        match_index = progressMatchIndex(r, i);
+        if (healthy && match_index < r->commit_index) {
+            continue;
+        }
+        if (id != 0 && match_index <= best) {
+            continue;
+        }
+        id = server->id;
+        best = match_index;
+    }
+
+    return id;
+}
+
+int membershipLeadershipHandoff(struct raft *r,
+                                bool healthy,
+                                raft_transfer_cb cb)
+{
+    raft_id id;
+    unsigned i;
+    int rv;
+
+    assert(r->state == RAFT_LEADER);
+
+    if (r->transfer != NULL) {
+        return RAFT_BUSY;
+    }
+
+    id = membershipSelectHandoffTarget(r, healthy);
+    if (id == 0) {
+        tracef("no voter to hand leadership off to");
+        return RAFT_NOTFOUND;
+    }
+
+    if (r->handoff == NULL) {
+        r->handoff = raft_malloc(sizeof *r->handoff);
+        if (r->handoff == NULL) {
+            return RAFT_NOMEM;
+        }
+        r->handoff->data = r;
+    }
+
+    tracef("hand leadership off to %llu", id);
+    membershipLeadershipTransferInit(r, r->handoff, id, cb);
+
+    i = configurationIndexOf(&r->configuration, id);
+    assert(i < r->configuration.n);
+
+    /* If the target is not up-to-date yet, the TimeoutNow message will be sent
+     * by replicationUpdate() once it catches up. */
+    if (progressIsUpToDate(r, i)) {
+        rv = membershipLeadershipTransferStart(r);
+        if (rv != 0) {
+            r->transfer = NULL;
+            return rv;
+        }
+    }
+
+    return 0;
+}
+
 void membershipLeadershipTransferClose(struct raft *r)
 {
     struct raft_transfer *req = r->transfer;
@@ -204,3 +288,5 @@ void membershipLeadershipTransferClose(struct raft *r)
         cb(req);
     }
 }
+
+#undef tracef
@@ -46,6 +46,17 @@ void membershipLeadershipTransferInit(struct raft *r,
  * server. */
 int membershipLeadershipTransferStart(struct raft *r);
 
+/* Transfer leadership away from this server to the voter with the highest
+ * match index, invoking @cb when done. If @healthy is true, only voters that
+ * are keeping up with the commit index are considered. Return RAFT_BUSY if a
+ * leadership transfer is already in progress and RAFT_NOTFOUND if there's no
+ * suitable voter.
+ *
+ * It must be called only by leaders. */
+int membershipLeadershipHandoff(struct raft *r,
+                                bool healthy,
+                                raft_transfer_cb cb);
+
 /* Finish a leadership transfer (whether successful or not), resetting the
  * leadership transfer state and firing the user callback. */
 void membershipLeadershipTransferClose(struct raft *r);
@@ -0,0 +1,40 @@
+#include "pool.h"
+
+#include "assert.h"
+#include "heap.h"
+
+void *poolGet(void **pool, size_t size)
+{
+    struct poolNode *node = *pool;
+    assert(size >= sizeof *node);
+    if (node == NULL) {
+        return HeapMalloc(size);
+    }
+    *pool = node->next;
+    return node;
+}
+
+void poolPut(void **pool, void *object)
+{
+    struct poolNode *head = *pool;
+    struct poolNode *node = object;
+    unsigned n = head != NULL ? head->n : 0;
+    if (n >= POOL__MAX) {
+        HeapFree(object);
+        return;
+    }
+    node->next = head;
+    node->n = n + 1;
+    *pool = node;
+}
+
+void poolClose(void **pool)
+{
+    struct poolNode *node = *pool;
+    while (node != NULL) {
+        struct poolNode *next = node->next;
+        HeapFree(node);
+        node = next;
+    }
+    *pool = NULL;
+}
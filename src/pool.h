@@ -0,0 +1,34 @@
+/* Free lists of fixed-size objects.
+ *
+ * The control blocks of requests that are created and destroyed at message
+ * rate are recycled through a free list instead of going back to the heap. A
+ * pool is just a pointer to the first free object, and free objects are chained
+ * through their first bytes, so they must be at least as large as a struct
+ * poolNode. At most POOL__MAX objects are kept, the excess is released. */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stddef.h>
+
+#define POOL__MAX 64
+
+/* Header of a free object. */
+struct poolNode
+{
+    struct poolNode *next; /* Next free object */
+    unsigned n;            /* Number of free objects from this one onwards */
+};
+
+/* Return a free object from the pool, or allocate a new one of the given size
+ * if the pool is empty. */
+void *poolGet(void **pool, size_t size);
+
+/* Add an object obtained with poolGet() to the pool, or release it if the pool
+ * is full. */
+void poolPut(void **pool, void *object);
+
+/* Release all the objects in the pool. */
+void poolClose(void **pool);
+
+#endif /* POOL_H_ */
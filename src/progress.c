@@ -3,6 +3,7 @@
 #include "assert.h"
 #include "configuration.h"
 #include "log.h"
+#include "rtt.h"
 #include "tracing.h"
 
 /* Set to 1 to enable tracing. */
@@ -28,6 +29,9 @@ static void initProgress(struct raft_progress *p, raft_index last_index)
     p->snapshot_index = 0;
     p->last_send = 0;
     p->recent_recv = false;
+    p->rtt_start = 0;
+    p->srtt = 0;
+    p->rttvar = 0;
     p->state = PROGRESS__PROBE;
 }
 
@@ -109,7 +113,7 @@ bool progressShouldReplicate(struct raft *r, unsigned i)
 {
     struct raft_progress *p = &r->leader_state.progress[i];
     raft_time now = r->io->time(r->io);
-    bool needs_heartbeat = now - p->last_send >= r->heartbeat_timeout;
+    bool needs_heartbeat = now - p->last_send >= progressHeartbeatTimeout(r);
     raft_index last_index = logLastIndex(&r->log);
     bool result = false;
 
@@ -157,6 +161,54 @@ void progressUpdateLastSend(struct raft *r, unsigned i)
     r->leader_state.progress[i].last_send = r->io->time(r->io);
 }
 
+void progressRttStart(struct raft *r, unsigned i)
+{
+    struct raft_progress *p = &r->leader_state.progress[i];
+    if (p->rtt_start == 0) {
+        p->rtt_start = r->io->time(r->io);
+    }
+}
+
+void progressRttSample(struct raft *r, unsigned i)
+{
+    struct raft_progress *p = &r->leader_state.progress[i];
+    raft_time now = r->io->time(r->io);
+    unsigned rtt = 0;
+    unsigned j;
+
+    if (p->rtt_start == 0) {
+        return;
+    }
+    rttUpdate(&p->srtt, &p->rttvar, (unsigned)(now - p->rtt_start));
+    p->rtt_start = 0;
+
+    /* The heartbeat interval must accommodate the slowest follower. */
+    for (j = 0; j < r->configuration.n; j++) {
+        struct raft_progress *q = &r->leader_state.progress[j];
+        if (r->configuration.servers[j].id == r->id || q->srtt == 0) {
+            continue;
+        }
+        rtt = max(rtt, rttUpperBound(q->srtt, q->rttvar));
+    }
+    r->rtt = rtt;
+}
+
+unsigned progressHeartbeatTimeout(struct raft *r)
+{
+    unsigned timeout;
+
+    if (!r->adaptive_timeouts || r->rtt == 0) {
+        return r->heartbeat_timeout;
+    }
+
+    /* Leave room for a couple of round trips before the next heartbeat. */
+    timeout = 2 * r->rtt;
+    timeout = max(timeout, r->min_heartbeat_timeout);
+    timeout = min(timeout, r->heartbeat_timeout);
+
+    return timeout;
+}
+
 bool progressResetRecentRecv(struct raft *r, const unsigned i)
 {
     bool prev = r->leader_state.progress[i].recent_recv;
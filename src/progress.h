@@ -49,6 +49,19 @@ raft_index progressMatchIndex(struct raft *r, unsigned i);
  * sent. */
 void progressUpdateLastSend(struct raft *r, unsigned i);
 
+/* Start timing the round trip of an AppendEntries RPC sent to the i'th server,
+ * unless another one is already being timed. */
+void progressRttStart(struct raft *r, unsigned i);
+
+/* Complete the round trip timed by progressRttStart() after an AppendEntries
+ * result from the i'th server was received, and update the round-trip time
+ * estimates. */
+void progressRttSample(struct raft *r, unsigned i);
+
+/* Return the current heartbeat interval, which is derived from the round-trip
+ * time estimate if adaptive timeouts are enabled. */
+unsigned progressHeartbeatTimeout(struct raft *r);
+
 /* Reset to false the recent_recv flag of the server at the given index,
  * returning the previous value.
  *
@@ -8,9 +8,11 @@
 #include "convert.h"
 #include "election.h"
 #include "err.h"
+#include "queue.h"
 #include "heap.h"
 #include "log.h"
 #include "membership.h"
+#include "pool.h"
 #include "tracing.h"
 
 #define DEFAULT_ELECTION_TIMEOUT 1000 /* One second */
@@ -29,6 +31,7 @@ int raft_init(struct raft *r,
               const raft_id id,
               const char *address)
 {
+    unsigned i;
     int rv;
     assert(r != NULL);
     r->io = io;
@@ -65,6 +68,24 @@ int raft_init(struct raft *r,
     r->pre_vote = false;
     r->max_catch_up_rounds = DEFAULT_MAX_CATCH_UP_ROUNDS;
     r->max_catch_up_round_duration = DEFAULT_MAX_CATCH_UP_ROUND_DURATION;
+    r->stall_threshold = 0;
+    r->last_tick = 0;
+    r->handoff = NULL;
+    r->shutdown_cb = NULL;
+    r->adaptive_timeouts = false;
+    r->min_election_timeout = DEFAULT_ELECTION_TIMEOUT;
+    r->min_heartbeat_timeout = DEFAULT_HEARTBEAT_TIMEOUT;
+    r->rtt = 0;
+    r->contact_interval = 0;
+    r->contact_jitter = 0;
+    r->forwarding = false;
+    QUEUE_INIT(&r->forwarded);
+    r->forward_term = 0;
+    r->forward_start = 0;
+    r->heap = NULL;
+    for (i = 0; i < sizeof r->pools / sizeof r->pools[0]; i++) {
+        r->pools[i] = NULL;
+    }
     rv = r->io->init(r->io, r->id, r->address);
     if (rv != 0) {
         ErrMsgTransfer(r->io->errmsg, r->errmsg, "io");
@@ -82,22 +103,65 @@ err:
 static void ioCloseCb(struct raft_io *io)
 {
     struct raft *r = io->data;
+    unsigned i;
     raft_free(r->address);
+    if (r->handoff != NULL) {
+        raft_free(r->handoff);
+    }
     logClose(&r->log);
     raft_configuration_close(&r->configuration);
+    for (i = 0; i < sizeof r->pools / sizeof r->pools[0]; i++) {
+        poolClose(&r->pools[i]);
+    }
     if (r->close_cb != NULL) {
         r->close_cb(r);
     }
 }
 
+static void shutdownTransferCb(struct raft_transfer *req);
+
 void raft_close(struct raft *r, void (*cb)(struct raft *r))
 {
+    struct raft_heap *heap;
     assert(r->close_cb == NULL);
+    heap = HeapEnter(r->heap);
+    /* Don't close again when aborting a raft_shutdown() transfer. */
+    if (r->transfer != NULL && r->transfer->cb == shutdownTransferCb) {
+        r->transfer->cb = NULL;
+    }
     if (r->state != RAFT_UNAVAILABLE) {
         convertToUnavailable(r);
     }
     r->close_cb = cb;
     r->io->close(r->io, ioCloseCb);
+    HeapLeave(heap);
+}
+
+/* Invoked when the leadership transfer started by raft_shutdown() completes,
+ * either successfully or not. */
+static void shutdownTransferCb(struct raft_transfer *req)
+{
+    struct raft *r = req->data;
+    raft_close_cb cb = r->shutdown_cb;
+    r->shutdown_cb = NULL;
+    raft_close(r, cb);
+}
+
+void raft_shutdown(struct raft *r, void (*cb)(struct raft *r))
+{
+    struct raft_heap *heap;
+    int rv;
+    if (r->state == RAFT_LEADER && r->transfer == NULL) {
+        r->shutdown_cb = cb;
+        heap = HeapEnter(r->heap);
+        rv = membershipLeadershipHandoff(r, false, shutdownTransferCb);
+        HeapLeave(heap);
+        if (rv == 0) {
+            return;
+        }
+        r->shutdown_cb = NULL;
+    }
+    raft_close(r, cb);
 }
 
 void raft_set_election_timeout(struct raft *r, const unsigned msecs)
@@ -130,11 +194,36 @@ void raft_set_max_catch_up_round_duration(struct raft *r, unsigned msecs)
     r->max_catch_up_round_duration = msecs;
 }
 
+void raft_set_stall_threshold(struct raft *r, unsigned msecs)
+{
+    r->stall_threshold = msecs;
+}
+
 void raft_set_pre_vote(struct raft *r, bool enabled)
 {
     r->pre_vote = enabled;
 }
 
+void raft_set_forwarding(struct raft *r, bool enabled)
+{
+    r->forwarding = enabled;
+}
+
+void raft_set_adaptive_timeouts(struct raft *r,
+                                bool enabled,
+                                unsigned min_election_timeout,
+                                unsigned min_heartbeat_timeout)
+{
+    r->adaptive_timeouts = enabled;
+    r->min_election_timeout = min_election_timeout;
+    r->min_heartbeat_timeout = min_heartbeat_timeout;
+}
+
+void raft_set_heap(struct raft *r, struct raft_heap *heap)
+{
+    r->heap = heap;
+}
+
 const char *raft_errmsg(struct raft *r)
 {
     return r->errmsg;
@@ -3,11 +3,13 @@
 #include "assert.h"
 #include "convert.h"
 #include "entry.h"
+#include "forward.h"
 #include "heap.h"
 #include "log.h"
 #include "membership.h"
 #include "recv_append_entries.h"
 #include "recv_append_entries_result.h"
+#include "recv_forward.h"
 #include "recv_install_snapshot.h"
 #include "recv_request_vote.h"
 #include "recv_request_vote_result.h"
@@ -28,7 +30,7 @@ static int recvMessage(struct raft *r, struct raft_message *message)
     int rv = 0;
 
     if (message->type < RAFT_IO_APPEND_ENTRIES ||
-        message->type > RAFT_IO_TIMEOUT_NOW) {
+        message->type > RAFT_IO_FORWARD_RESULT) {
         tracef("received unknown message type type: %d", message->type);
         return 0;
     }
@@ -69,6 +71,15 @@ static int recvMessage(struct raft *r, struct raft_message *message)
             rv = recvTimeoutNow(r, message->server_id, message->server_address,
                                 &message->timeout_now);
             break;
+        case RAFT_IO_FORWARD:
+            rv = recvForward(r, message->server_id, message->server_address,
+                             &message->forward);
+            break;
+        case RAFT_IO_FORWARD_RESULT:
+            rv = recvForwardResult(r, message->server_id,
+                                   message->server_address,
+                                   &message->forward_result);
+            break;
     };
 
     if (rv != 0 && rv != RAFT_NOCONNECTION) {
@@ -91,6 +102,7 @@ static int recvMessage(struct raft *r, struct raft_message *message)
 void recvCb(struct raft_io *io, struct raft_message *message)
 {
     struct raft *r = io->data;
+    struct raft_heap *heap;
     int rv;
     if (r->state == RAFT_UNAVAILABLE) {
         switch (message->type) {
@@ -98,6 +110,10 @@ void recvCb(struct raft_io *io, struct raft_message *message)
                 entryBatchesDestroy(message->append_entries.entries,
                                     message->append_entries.n_entries);
                 break;
+            case RAFT_IO_FORWARD:
+                entryBatchesDestroy(message->forward.entries,
+                                    message->forward.n_entries);
+                break;
             case RAFT_IO_INSTALL_SNAPSHOT:
                 raft_configuration_close(&message->install_snapshot.conf);
                 raft_free(message->install_snapshot.data.base);
@@ -105,10 +121,12 @@ void recvCb(struct raft_io *io, struct raft_message *message)
         }
         return;
     }
+    heap = HeapEnter(r->heap);
     rv = recvMessage(r, message);
     if (rv != 0) {
         convertToUnavailable(r);
     }
+    HeapLeave(heap);
 }
 
 int recvBumpCurrentTerm(struct raft *r, raft_term term)
@@ -194,6 +212,8 @@ int recvEnsureMatchingTerms(struct raft *r, raft_term term, int *match)
 
 int recvUpdateLeader(struct raft *r, const raft_id id, const char *address)
 {
+    raft_id prev_id = r->follower_state.current_leader.id;
+
     assert(r->state == RAFT_FOLLOWER);
 
     r->follower_state.current_leader.id = id;
@@ -202,7 +222,7 @@ int recvUpdateLeader(struct raft *r, const raft_id id, const char *address)
      * done. */
     if (r->follower_state.current_leader.address != NULL &&
         strcmp(address, r->follower_state.current_leader.address) == 0) {
-        return 0;
+        goto out;
     }
 
     if (r->follower_state.current_leader.address != NULL) {
@@ -214,6 +234,12 @@ int recvUpdateLeader(struct raft *r, const raft_id id, const char *address)
     }
     strcpy(r->follower_state.current_leader.address, address);
 
+out:
+    /* Commands forwarded to the previous leader might have been lost. */
+    if (prev_id != id) {
+        forwardAbort(r);
+    }
+
     return 0;
 }
 
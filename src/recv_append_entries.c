@@ -2,6 +2,7 @@
 
 #include "assert.h"
 #include "convert.h"
+#include "election.h"
 #include "heap.h"
 #include "log.h"
 #include "recv.h"
@@ -98,6 +99,11 @@ int recvAppendEntries(struct raft *r,
 
     assert(r->state == RAFT_FOLLOWER);
 
+    /* Track how often the current leader contacts us. */
+    if (r->follower_state.current_leader.id == id) {
+        electionUpdateContactInterval(r);
+    }
+
     /* Update current leader because the term in this AppendEntries RPC is up to
      * date. */
     rv = recvUpdateLeader(r, id, address);
@@ -105,8 +111,13 @@ int recvAppendEntries(struct raft *r,
         return rv;
     }
 
-    /* Reset the election timer. */
-    r->election_timer_start = r->io->time(r->io);
+    /* Reset the election timer. With adaptive timeouts also pick a new
+     * randomized timeout, since the base timeout might have changed. */
+    if (r->adaptive_timeouts) {
+        electionResetTimer(r);
+    } else {
+        r->election_timer_start = r->io->time(r->io);
+    }
 
     /* If we are installing a snapshot, ignore these entries. TODO: we should do
      * something smarter, e.g. buffering the entries in the I/O backend, which
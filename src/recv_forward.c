@@ -0,0 +1,122 @@
+#include "recv_forward.h"
+
+#include "assert.h"
+#include "entry.h"
+#include "forward.h"
+#include "heap.h"
+#include "log.h"
+#include "replication.h"
+#include "tracing.h"
+
+/* Set to 1 to enable tracing. */
+#if 0
+#define tracef(...) Tracef(r->tracer, __VA_ARGS__)
+#else
+#define tracef(...)
+#endif
+
+static void sendForwardResultCb(struct raft_io_send *req, int status)
+{
+    (void)status;
+    HeapFree(req);
+}
+
+/* Append the forwarded commands to our log and start replicating them. Return
+ * the index of the first appended entry, or zero if the commands can't be
+ * accepted. */
+static raft_index recvForwardAppend(struct raft *r, struct raft_forward *args)
+{
+    raft_index index;
+    unsigned i;
+    int rv;
+
+    /* Only accept commands that were sent to us as leader of the current
+     * term, and not while transferring leadership. */
+    if (r->state != RAFT_LEADER || r->transfer != NULL ||
+        args->term != r->current_term || args->n_entries == 0) {
+        tracef("can't accept forwarded commands -> reject");
+        goto err;
+    }
+
+    index = logLastIndex(&r->log) + 1;
+    tracef("%u forwarded commands starting at %lld", args->n_entries, index);
+
+    for (i = 0; i < args->n_entries; i++) {
+        struct raft_entry *entry = &args->entries[i];
+        rv = logAppend(&r->log, r->current_term, RAFT_COMMAND, &entry->buf,
+                       entry->batch);
+        if (rv != 0) {
+            goto err_after_log_append;
+        }
+    }
+
+    rv = replicationTrigger(r, index);
+    if (rv != 0) {
+        goto err_after_log_append;
+    }
+
+    raft_free(args->entries);
+
+    return index;
+
+err_after_log_append:
+    logDiscard(&r->log, index);
+err:
+    entryBatchesDestroy(args->entries, args->n_entries);
+    return 0;
+}
+
+int recvForward(struct raft *r,
+                const raft_id id,
+                const char *address,
+                struct raft_forward *args)
+{
+    struct raft_message message;
+    struct raft_forward_result *result = &message.forward_result;
+    struct raft_io_send *req;
+    int rv;
+
+    assert(r != NULL);
+    assert(id > 0);
+    assert(args != NULL);
+
+    /* Echo back the term of the request, so the follower can match this
+     * result with the message it sent. */
+    result->term = args->term;
+    result->index = recvForwardAppend(r, args);
+
+    message.type = RAFT_IO_FORWARD_RESULT;
+    message.server_id = id;
+    message.server_address = address;
+
+    req = HeapMalloc(sizeof *req);
+    if (req == NULL) {
+        return 0;
+    }
+    req->data = r;
+
+    rv = r->io->send(r->io, req, &message, sendForwardResultCb);
+    if (rv != 0) {
+        HeapFree(req);
+    }
+
+    return 0;
+}
+
+int recvForwardResult(struct raft *r,
+                      const raft_id id,
+                      const char *address,
+                      const struct raft_forward_result *result)
+{
+    assert(r != NULL);
+    assert(id > 0);
+    assert(result != NULL);
+
+    (void)address;
+
+    forwardResult(r, id, result);
+
+    return 0;
+}
+
+#undef tracef
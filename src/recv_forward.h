@@ -0,0 +1,21 @@
+/* Receive a Forward message or its result. */
+
+#ifndef RECV_FORWARD_H_
+#define RECV_FORWARD_H_
+
+#include "../include/raft.h"
+
+/* Process a Forward message from the given server, taking ownership of its
+ * entries. */
+int recvForward(struct raft *r,
+                raft_id id,
+                const char *address,
+                struct raft_forward *args);
+
+/* Process a Forward result from the given server. */
+int recvForwardResult(struct raft *r,
+                      raft_id id,
+                      const char *address,
+                      const struct raft_forward_result *result);
+
+#endif /* RECV_FORWARD_H_ */
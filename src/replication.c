@@ -7,9 +7,11 @@
 #include "error.h"
 #endif
 #include "err.h"
+#include "forward.h"
 #include "heap.h"
 #include "log.h"
 #include "membership.h"
+#include "pool.h"
 #include "progress.h"
 #include "queue.h"
 #include "replication.h"
@@ -32,6 +34,14 @@
 #define min(a, b) ((a) < (b) ? (a) : (b))
 #endif
 
+/* Free lists of struct raft holding the control blocks of AppendEntries sends
+ * and of leader and follower disk writes. */
+enum {
+    REPLICATION__SEND_POOL = 0,
+    REPLICATION__LEADER_POOL,
+    REPLICATION__FOLLOWER_POOL
+};
+
 /* Context of a RAFT_IO_APPEND_ENTRIES request that was submitted with
  * raft_io_>send(). */
 struct sendAppendEntries
@@ -74,15 +84,16 @@ static void sendAppendEntriesCb(struct raft_io_send *send, const int status)
 
     /* Tell the log that we're done referencing these entries. */
     logRelease(&r->log, req->index, req->entries, req->n);
-    raft_free(req);
+    poolPut(&r->pools[REPLICATION__SEND_POOL], req);
 }
 
 /* Send an AppendEntries message to the i'th server, including all log entries
- * from the given point onwards. */
+ * from the given point onwards, or none if @heartbeat is true. */
 static int sendAppendEntries(struct raft *r,
                              const unsigned i,
                              const raft_index prev_index,
-                             const raft_term prev_term)
+                             const raft_term prev_term,
+                             const bool heartbeat)
 {
     struct raft_server *server = &r->configuration.servers[i];
     struct raft_message message;
@@ -95,10 +106,16 @@ static int sendAppendEntries(struct raft *r,
     args->prev_log_index = prev_index;
     args->prev_log_term = prev_term;
 
-    /* TODO: implement a limit to the total size of the entries being sent */
-    rv = logAcquire(&r->log, next_index, &args->entries, &args->n_entries);
-    if (rv != 0) {
-        goto err;
+    if (heartbeat) {
+        args->entries = NULL;
+        args->n_entries = 0;
+    } else {
+        /* TODO: implement a limit to the total size of the entries being
+         * sent */
+        rv = logAcquire(&r->log, next_index, &args->entries, &args->n_entries);
+        if (rv != 0) {
+            goto err;
+        }
     }
 
     /* From Section 3.5:
@@ -119,7 +136,7 @@ static int sendAppendEntries(struct raft *r,
     message.server_id = server->id;
     message.server_address = server->address;
 
-    req = raft_malloc(sizeof *req);
+    req = poolGet(&r->pools[REPLICATION__SEND_POOL], sizeof *req);
     if (req == NULL) {
         rv = RAFT_NOMEM;
         goto err_after_entries_acquired;
@@ -136,6 +153,8 @@ static int sendAppendEntries(struct raft *r,
         goto err_after_req_alloc;
     }
 
+    progressRttStart(r, i);
+
     if (progressState(r, i) == PROGRESS__PIPELINE) {
         /* Optimistically update progress. */
         progressOptimisticNextIndex(r, i, req->index + req->n);
@@ -144,7 +163,7 @@ static int sendAppendEntries(struct raft *r,
     return 0;
 
 err_after_req_alloc:
-    raft_free(req);
+    poolPut(&r->pools[REPLICATION__SEND_POOL], req);
 err_after_entries_acquired:
     logRelease(&r->log, next_index, args->entries, args->n_entries);
 err:
@@ -152,6 +171,29 @@ err:
     return rv;
 }
 
+/* The connection to the i'th server is congested and the I/O backend refused
+ * to queue more entries for it. Stop pipelining and just send a heartbeat
+ * starting at the match index, so the server keeps following us while the
+ * backlog drains. The entries will be sent again at the next heartbeat. */
+static int sendCongested(struct raft *r, const unsigned i)
+{
+    raft_index prev_index;
+    raft_term prev_term;
+
+    tracef("connection to server %u congested -> probe",
+           r->configuration.servers[i].id);
+
+    progressToProbe(r, i);
+
+    prev_index = progressNextIndex(r, i) - 1;
+    prev_term = logTermOf(&r->log, prev_index);
+    if (prev_index > 0 && prev_term == 0) {
+        return RAFT_BUSY;
+    }
+
+    return sendAppendEntries(r, i, prev_index, prev_term, true);
+}
+
 /* Context of a RAFT_IO_INSTALL_SNAPSHOT request that was submitted with
  * raft_io_>send(). */
 struct sendInstallSnapshot
@@ -191,6 +233,7 @@ static void sendSnapshotGetCb(struct raft_io_snapshot_get *get,
 {
     struct sendInstallSnapshot *req = get->data;
     struct raft *r = req->raft;
+    struct raft_heap *heap = HeapEnter(r->heap);
     struct raft_message message;
     struct raft_install_snapshot *args = &message.install_snapshot;
     const struct raft_server *server = NULL;
@@ -257,7 +300,7 @@ abort:
     }
     raft_free(req);
 out:
-    return;
+    HeapLeave(heap);
 }
 
 /* Send the latest snapshot to the i'th server */
@@ -303,6 +346,7 @@ int replicationProgress(struct raft *r, unsigned i)
     raft_index next_index = progressNextIndex(r, i);
     raft_index prev_index;
     raft_term prev_term;
+    int rv;
 
     assert(r->state == RAFT_LEADER);
     assert(server->id != r->id);
@@ -349,7 +393,11 @@ int replicationProgress(struct raft *r, unsigned i)
         }
     }
 
-    return sendAppendEntries(r, i, prev_index, prev_term);
+    rv = sendAppendEntries(r, i, prev_index, prev_term, false);
+    if (rv == RAFT_BUSY) {
+        rv = sendCongested(r, i);
+    }
+    return rv;
 
 send_snapshot:
     return sendSnapshot(r, i);
@@ -401,6 +449,7 @@ struct appendLeader
     raft_index index;           /* Index of the first entry in the request. */
     struct raft_entry *entries; /* Entries referenced in the request. */
     unsigned n;                 /* Length of the entries array. */
+    raft_time start;            /* Time the request was submitted. */
     struct raft_io_append req;
 };
 
@@ -464,6 +513,7 @@ static void appendLeaderCb(struct raft_io_append *req, int status)
 {
     struct appendLeader *request = req->data;
     struct raft *r = request->raft;
+    struct raft_heap *heap = HeapEnter(r->heap);
     size_t server_index;
     int rv;
 
@@ -522,13 +572,22 @@ static void appendLeaderCb(struct raft_io_append *req, int status)
         /* TODO: just log the error? */
     }
 
+    /* If the disk write took too long, hand leadership off to a healthier
+     * server. */
+    if (r->state == RAFT_LEADER && r->stall_threshold > 0 &&
+        r->io->time(r->io) - request->start > r->stall_threshold) {
+        tracef("leader: disk write stalled -> hand off leadership");
+        membershipLeadershipHandoff(r, true, NULL);
+    }
+
 out:
     /* Tell the log that we're done referencing these entries. */
     logRelease(&r->log, request->index, request->entries, request->n);
     if (status != 0) {
         logTruncate(&r->log, request->index);
     }
-    raft_free(request);
+    poolPut(&r->pools[REPLICATION__LEADER_POOL], request);
+    HeapLeave(heap);
 }
 
 /* Submit a disk write for all entries from the given index onward. */
@@ -554,7 +613,7 @@ static int appendLeader(struct raft *r, raft_index index)
     assert(n > 0);
 
     /* Allocate a new request. */
-    request = raft_malloc(sizeof *request);
+    request = poolGet(&r->pools[REPLICATION__LEADER_POOL], sizeof *request);
     if (request == NULL) {
         rv = RAFT_NOMEM;
         goto err_after_entries_acquired;
@@ -564,6 +623,7 @@ static int appendLeader(struct raft *r, raft_index index)
     request->index = index;
     request->entries = entries;
     request->n = n;
+    request->start = r->io->time(r->io);
     request->req.data = request;
 
     rv = r->io->append(r->io, &request->req, entries, n, appendLeaderCb);
@@ -575,7 +635,7 @@ static int appendLeader(struct raft *r, raft_index index)
     return 0;
 
 err_after_request_alloc:
-    raft_free(request);
+    poolPut(&r->pools[REPLICATION__LEADER_POOL], request);
 err_after_entries_acquired:
     logRelease(&r->log, index, entries, n);
 err:
@@ -670,6 +730,7 @@ int replicationUpdate(struct raft *r,
     assert(i < r->configuration.n);
 
     progressMarkRecentRecv(r, i);
+    progressRttSample(r, i);
 
     /* If the RPC failed because of a log mismatch, retry.
      *
@@ -824,6 +885,7 @@ static void appendFollowerCb(struct raft_io_append *req, int status)
     struct raft *r = request->raft;
     struct raft_append_entries *args = &request->args;
     struct raft_append_entries_result result;
+    struct raft_heap *heap = HeapEnter(r->heap);
     size_t i;
     size_t j;
     int rv;
@@ -903,7 +965,8 @@ out:
     logRelease(&r->log, request->index, request->args.entries,
                request->args.n_entries);
 
-    raft_free(request);
+    poolPut(&r->pools[REPLICATION__FOLLOWER_POOL], request);
+    HeapLeave(heap);
 }
 
 /* Check the log matching property against an incoming AppendEntries request.
@@ -1003,6 +1066,7 @@ static int deleteConflictingEntries(struct raft *r,
                 return rv;
             }
             logTruncate(&r->log, entry_index);
+            forwardTruncate(r, entry_index);
 
             /* Drop information about previously stored entries that have just
              * been discarded. */
@@ -1087,7 +1151,7 @@ int replicationAppend(struct raft *r,
 
     *async = true;
 
-    request = raft_malloc(sizeof *request);
+    request = poolGet(&r->pools[REPLICATION__FOLLOWER_POOL], sizeof *request);
     if (request == NULL) {
         rv = RAFT_NOMEM;
         goto err;
@@ -1137,7 +1201,7 @@ err_after_acquire_entries:
                request->args.n_entries);
 
 err_after_request_alloc:
-    raft_free(request);
+    poolPut(&r->pools[REPLICATION__FOLLOWER_POOL], request);
 
 err:
     assert(rv != 0);
@@ -1156,6 +1220,7 @@ static void installSnapshotCb(struct raft_io_snapshot_put *req, int status)
     struct raft *r = request->raft;
     struct raft_snapshot *snapshot = &request->snapshot;
     struct raft_append_entries_result result;
+    struct raft_heap *heap = HeapEnter(r->heap);
     int rv;
 
     r->snapshot.put.data = NULL;
@@ -1191,6 +1256,12 @@ static void installSnapshotCb(struct raft_io_snapshot_put *req, int status)
 
     tracef("restored snapshot with last index %llu", snapshot->index);
 
+    /* The log was discarded, so we can't tell anymore whether the entries of
+     * forwarded commands will be overwritten. */
+    if (r->state == RAFT_FOLLOWER) {
+        forwardTruncate(r, 0);
+    }
+
     result.rejected = 0;
 
     goto respond;
@@ -1208,6 +1279,7 @@ respond:
     }
 
     raft_free(request);
+    HeapLeave(heap);
 }
 
 int replicationInstallSnapshot(struct raft *r,
@@ -1307,6 +1379,10 @@ static int applyCommand(struct raft *r,
     if (rv != 0) {
         return rv;
     }
+    if (r->state == RAFT_FOLLOWER) {
+        forwardApplied(r, index, result);
+        return 0;
+    }
     req = (struct raft_apply *)getRequest(r, index, RAFT_COMMAND);
     if (req != NULL && req->cb != NULL) {
         req->cb(req, 0, result);
@@ -1389,6 +1465,7 @@ static bool shouldTakeSnapshot(struct raft *r)
 static void takeSnapshotCb(struct raft_io_snapshot_put *req, int status)
 {
     struct raft *r = req->data;
+    struct raft_heap *heap = HeapEnter(r->heap);
     struct raft_snapshot *snapshot;
 
     r->snapshot.put.data = NULL;
@@ -1405,6 +1482,7 @@ static void takeSnapshotCb(struct raft_io_snapshot_put *req, int status)
 out:
     snapshotClose(&r->snapshot.pending);
     r->snapshot.pending.term = 0;
+    HeapLeave(heap);
 }
 
 static int takeSnapshot(struct raft *r)
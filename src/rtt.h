@@ -0,0 +1,38 @@
+/* Round-trip time estimation, used by adaptive timeouts. */
+
+#ifndef RTT_H_
+#define RTT_H_
+
+#if defined(__clang__)
+#define RTT__INLINE static inline __attribute__((unused))
+#else
+#define RTT__INLINE static inline
+#endif
+
+/* Update a smoothed estimate and its mean deviation with a new sample, using
+ * the same gains as TCP's retransmission timer (RFC 6298). A zero estimate
+ * means that no sample has been collected yet. */
+RTT__INLINE void rttUpdate(unsigned *srtt, unsigned *rttvar, unsigned sample)
+{
+    unsigned delta;
+    if (sample == 0) {
+        sample = 1;
+    }
+    if (*srtt == 0) {
+        *srtt = sample;
+        *rttvar = sample / 2;
+        return;
+    }
+    delta = *srtt > sample ? *srtt - sample : sample - *srtt;
+    *rttvar = (3 * *rttvar + delta) / 4;
+    *srtt = (7 * *srtt + sample) / 8;
+}
+
+/* Return a conservative upper bound of the observed values, roughly their
+ * high percentile. */
+RTT__INLINE unsigned rttUpperBound(unsigned srtt, unsigned rttvar)
+{
+    return srtt + 4 * rttvar;
+}
+
+#endif /* RTT_H_ */
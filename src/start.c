@@ -4,6 +4,7 @@
 #include "convert.h"
 #include "entry.h"
 #include "err.h"
+#include "heap.h"
 #include "log.h"
 #include "recv.h"
 #include "snapshot.h"
@@ -125,7 +126,8 @@ static int maybeSelfElect(struct raft *r)
     return 0;
 }
 
-int raft_start(struct raft *r)
+/* Load the persisted state and start the I/O backend. */
+static int start(struct raft *r)
 {
     struct raft_snapshot *snapshot;
     raft_index snapshot_index = 0;
@@ -139,6 +141,11 @@ int raft_start(struct raft *r)
     assert(r->state == RAFT_UNAVAILABLE);
     assert(r->heartbeat_timeout != 0);
     assert(r->heartbeat_timeout < r->election_timeout);
+    assert(!r->adaptive_timeouts ||
+           (r->min_heartbeat_timeout != 0 &&
+            r->min_heartbeat_timeout <= r->heartbeat_timeout &&
+            r->heartbeat_timeout < r->min_election_timeout &&
+            r->min_election_timeout <= r->election_timeout));
     assert(logNumEntries(&r->log) == 0);
     assert(logSnapshotIndex(&r->log) == 0);
     assert(r->last_stored == 0);
@@ -188,9 +195,12 @@ int raft_start(struct raft *r)
     }
 
     /* Start the I/O backend. The tickCb function is expected to fire every
-     * r->heartbeat_timeout milliseconds and recvCb whenever an RPC is
-     * received. */
-    rv = r->io->start(r->io, r->heartbeat_timeout, tickCb, recvCb);
+     * r->heartbeat_timeout milliseconds (or r->min_heartbeat_timeout if
+     * adaptive timeouts are enabled) and recvCb whenever an RPC is received. */
+    rv = r->io->start(r->io,
+                      r->adaptive_timeouts ? r->min_heartbeat_timeout
+                                           : r->heartbeat_timeout,
+                      tickCb, recvCb);
     if (rv != 0) {
         return rv;
     }
@@ -209,4 +219,12 @@ int raft_start(struct raft *r)
     return 0;
 }
 
+int raft_start(struct raft *r)
+{
+    struct raft_heap *heap = HeapEnter(r->heap);
+    int rv = start(r);
+    HeapLeave(heap);
+    return rv;
+}
+
 #undef tracef
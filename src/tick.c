@@ -3,6 +3,8 @@
 #include "configuration.h"
 #include "convert.h"
 #include "election.h"
+#include "forward.h"
+#include "heap.h"
 #include "membership.h"
 #include "progress.h"
 #include "replication.h"
@@ -24,6 +26,9 @@ static int tickFollower(struct raft *r)
     assert(r != NULL);
     assert(r->state == RAFT_FOLLOWER);
 
+    /* Retry or expire commands forwarded to the leader. */
+    forwardTick(r);
+
     server = configurationGet(&r->configuration, r->id);
 
     /* If we have been removed from the configuration, or maybe we didn't
@@ -217,25 +222,46 @@ static int tick(struct raft *r)
     return rv;
 }
 
-void tickCb(struct raft_io *io)
+/* Run a tick, handing off leadership if the tick fired late and failing
+ * leadership transfers that took too long. */
+static void tickRun(struct raft *r)
 {
-    struct raft *r;
+    raft_time now;
+    raft_time lag;
     int rv;
-    r = io->data;
+    now = r->io->time(r->io);
+    lag = r->last_tick > 0 ? now - r->last_tick : 0;
+    r->last_tick = now;
     rv = tick(r);
     if (rv != 0) {
         convertToUnavailable(r);
         return;
     }
 
+    /* If the event loop is lagging behind, hand leadership off to a healthier
+     * server. */
+    if (r->state == RAFT_LEADER && r->stall_threshold > 0 &&
+        lag > r->stall_threshold) {
+        tracef("leader: tick delayed by %llu ms -> hand off leadership", lag);
+        membershipLeadershipHandoff(r, true, NULL);
+    }
+
     /* For all states: if there is a leadership transfer request in progress,
      * check if it's expired. */
     if (r->transfer != NULL) {
-        raft_time now = r->io->time(r->io);
+        now = r->io->time(r->io);
         if (now - r->transfer->start >= r->election_timeout) {
             membershipLeadershipTransferClose(r);
         }
     }
 }
 
+void tickCb(struct raft_io *io)
+{
+    struct raft *r = io->data;
+    struct raft_heap *heap = HeapEnter(r->heap);
+    tickRun(r);
+    HeapLeave(heap);
+}
+
 #undef tracef
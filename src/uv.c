@@ -13,11 +13,13 @@
 #include "configuration.h"
 #include "entry.h"
 #include "heap.h"
+#include "pool.h"
 #include "snapshot.h"
 #include "tracing.h"
 #include "uv.h"
 #include "uv_encoding.h"
 #include "uv_os.h"
+#include "uv_writer.h"
 
 /* Set to 1 to enable tracing. */
 #if 0
@@ -31,6 +33,13 @@
  * TODO: implement an exponential backoff instead.  */
 #define CONNECT_RETRY_DELAY 1000
 
+/* Keep at most 3 messages and 8 megabytes for a disconnected peer. */
+#define SEND_PENDING_MAX 3
+#define SEND_PENDING_MAX_SIZE (8 * 1024 * 1024)
+
+/* Consider a peer connection congested once 64 megabytes are queued. */
+#define SEND_QUEUE_LIMIT (64 * 1024 * 1024)
+
 /* Implementation of raft_io->config. */
 static int uvInit(struct raft_io *io, raft_id id, const char *address)
 {
@@ -105,6 +114,14 @@ static int uvStart(struct raft_io *io,
     return 0;
 }
 
+static void uvWriterContextCloseCb(struct UvWriterContext *context)
+{
+    struct uv *uv = context->data;
+    HeapFree(context);
+    uv->writer_ctx = NULL;
+    uvMaybeFireCloseCb(uv);
+}
+
 void uvMaybeFireCloseCb(struct uv *uv)
 {
     if (!uv->closing) {
@@ -141,9 +158,22 @@ void uvMaybeFireCloseCb(struct uv *uv)
     if (!QUEUE_IS_EMPTY(&uv->aborting)) {
         return;
     }
+    if (uv->recv_thread != NULL) {
+        return;
+    }
 
     assert(uv->truncate_work.data == NULL);
 
+    /* Once the writers of all open segments are gone, close the completion
+     * context they were sharing. */
+    if (uv->writer_ctx != NULL) {
+        if (uv->writer_ctx->n_writers == 0 && !uv->writer_ctx->closing) {
+            uv->writer_ctx->data = uv;
+            UvWriterContextClose(uv->writer_ctx, uvWriterContextCloseCb);
+        }
+        return;
+    }
+
     if (uv->close_cb != NULL) {
         uv->close_cb(uv->io);
     }
@@ -592,8 +622,26 @@ int raft_uv_init(struct raft_io *io,
     uv->segment_size = UV__MAX_SEGMENT_SIZE;
     uv->block_size = 0;
     QUEUE_INIT(&uv->clients);
+    uv->recv_threaded = false;
+    uvArenaPoolInit(&uv->arena_pool);
+    uv->heap = NULL;
+    uv->recv_thread = NULL;
+    uv->clients_index = NULL;
+    uv->clients_index_size = 0;
+    uv->n_clients = 0;
     QUEUE_INIT(&uv->servers);
     uv->connect_retry_delay = CONNECT_RETRY_DELAY;
+    uv->priority_channel = false;
+    uv->send_queue_limit = SEND_QUEUE_LIMIT;
+    uv->send_pending_max = SEND_PENDING_MAX;
+    uv->send_pending_max_size = SEND_PENDING_MAX_SIZE;
+    uv->send_rate = 0;
+    uv->send_rate_global = 0;
+    uv->send_bucket.tokens = 0;
+    uv->send_bucket.time = uv_now(loop);
+    uv->send_pool = NULL;
+    uv->n_throttled = 0;
+    uv->throttled_time = 0;
     uv->prepare_inflight = NULL;
     QUEUE_INIT(&uv->prepare_reqs);
     QUEUE_INIT(&uv->prepare_pool);
@@ -602,6 +650,8 @@ int raft_uv_init(struct raft_io *io,
     QUEUE_INIT(&uv->append_segments);
     QUEUE_INIT(&uv->append_pending_reqs);
     QUEUE_INIT(&uv->append_writing_reqs);
+    uv->append_pool = NULL;
+    uv->writer_ctx = NULL;
     uv->barrier = NULL;
     QUEUE_INIT(&uv->finalize_reqs);
     uv->finalize_work.data = NULL;
@@ -648,6 +698,9 @@ void raft_uv_close(struct raft_io *io)
 {
     struct uv *uv;
     uv = io->impl;
+    uvArenaPoolClose(&uv->arena_pool, uv->block_size);
+    poolClose(&uv->append_pool);
+    poolClose(&uv->send_pool);
     raft_free(uv);
 }
 
@@ -672,6 +725,73 @@ void raft_uv_set_connect_retry_delay(struct raft_io *io, unsigned msecs)
     uv->connect_retry_delay = msecs;
 }
 
+void raft_uv_set_send_pending_limit(struct raft_io *io,
+                                    unsigned n,
+                                    size_t size)
+{
+    struct uv *uv;
+    uv = io->impl;
+    uv->send_pending_max = n;
+    uv->send_pending_max_size = size;
+}
+
+void raft_uv_set_send_rate(struct raft_io *io, size_t rate, size_t global_rate)
+{
+    struct uv *uv;
+    uv = io->impl;
+    uv->send_rate = rate;
+    uv->send_rate_global = global_rate;
+}
+
+void raft_uv_throttle_stats(struct raft_io *io,
+                            unsigned long long *n,
+                            unsigned long long *msecs)
+{
+    struct uv *uv;
+    uv = io->impl;
+    *n = uv->n_throttled;
+    *msecs = uv->throttled_time;
+}
+
+void raft_uv_set_send_queue_limit(struct raft_io *io, size_t size)
+{
+    struct uv *uv;
+    uv = io->impl;
+    uv->send_queue_limit = size;
+}
+
+void raft_uv_set_priority_channel(struct raft_io *io, bool enabled)
+{
+    struct uv *uv;
+    uv = io->impl;
+    uv->priority_channel = enabled;
+}
+
+void raft_uv_set_recv_thread(struct raft_io *io, bool enabled)
+{
+    struct uv *uv;
+    uv = io->impl;
+    uv->recv_threaded = enabled;
+}
+
+void raft_uv_set_arena_pool(struct raft_io *io, unsigned n, bool huge_pages)
+{
+    struct uv *uv;
+    uv = io->impl;
+    if (n > UV__ARENA_POOL_MAX) {
+        n = UV__ARENA_POOL_MAX;
+    }
+    uv->arena_pool.max = n;
+    uv->arena_pool.huge_pages = huge_pages;
+}
+
+void raft_uv_set_heap(struct raft_io *io, struct raft_heap *heap)
+{
+    struct uv *uv;
+    uv = io->impl;
+    uv->heap = heap;
+}
+
 void raft_uv_set_tracer(struct raft_io *io, struct raft_tracer *tracer)
 {
     struct uv *uv;
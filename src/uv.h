@@ -49,6 +49,41 @@ struct uvMetadata
     raft_id voted_for;          /* Server ID of last vote, or 0 */
 };
 
+/* Token bucket used to limit the rate of bulk sends. */
+struct uvTokenBucket
+{
+    int64_t tokens; /* Available bytes, negative when in debt */
+    uint64_t time;  /* Time of the last refill, in milliseconds */
+};
+
+/* Maximum number of arenas that an arena pool can hold. */
+#define UV__ARENA_POOL_MAX 8
+
+/* Arenas released by segment buffers, kept around to be reused by other ones
+ * instead of being freed and allocated again. */
+struct uvArenaPool
+{
+    unsigned max;                         /* Maximum number of arenas to keep */
+    bool huge_pages;                      /* Use transparent huge pages */
+    unsigned n;                           /* Number of arenas in the pool */
+    uv_buf_t arenas[UV__ARENA_POOL_MAX]; /* Arenas available for reuse */
+};
+
+/* Initialize an empty pool, which doesn't keep any arena. */
+void uvArenaPoolInit(struct uvArenaPool *p);
+
+/* Release all arenas in the pool. */
+void uvArenaPoolClose(struct uvArenaPool *p, size_t block_size);
+
+/* Outbound connection to a peer, defined in uv_send.c. */
+struct uvClient;
+
+/* Thread receiving inbound messages, defined in uv_recv.c. */
+struct uvRecvThread;
+
+/* Completion context of asynchronous writes, defined in uv_writer.h. */
+struct UvWriterContext;
+
 /* Hold state of a libuv-based raft_io implementation. */
 struct uv
 {
@@ -65,8 +100,25 @@ struct uv
     size_t segment_size;                 /* Initial size of open segments. */
     size_t block_size;                   /* Block size of the data dir */
     queue clients;                       /* Outbound connections */
+    struct uvClient **clients_index;     /* Hash index of clients by ID */
+    unsigned clients_index_size;         /* Number of buckets in the index */
+    unsigned n_clients;                  /* Number of indexed clients */
     queue servers;                       /* Inbound connections */
+    bool recv_threaded;                  /* Receive in a dedicated thread */
+    struct uvArenaPool arena_pool;       /* Reusable segment write arenas */
+    struct raft_heap *heap;              /* Heap for our memory, or NULL */
+    struct uvRecvThread *recv_thread;    /* Receiving thread, if running */
     unsigned connect_retry_delay;        /* Client connection retry delay */
+    bool priority_channel;               /* Separate control connections */
+    size_t send_queue_limit;             /* Per-connection write queue cap */
+    unsigned send_pending_max;           /* Max messages while disconnected */
+    size_t send_pending_max_size;        /* Max bytes while disconnected */
+    size_t send_rate;                    /* Per-peer bulk bytes per second */
+    size_t send_rate_global;             /* Global bulk bytes per second */
+    struct uvTokenBucket send_bucket;    /* Global bulk send rate limit */
+    void *send_pool;                     /* Free send requests, see pool.h */
+    uint64_t n_throttled;                /* Number of throttled messages */
+    uint64_t throttled_time;             /* Total msecs spent throttled */
     void *prepare_inflight;              /* Segment being prepared */
     queue prepare_reqs;                  /* Pending prepare requests. */
     queue prepare_pool;                  /* Prepared open segments */
@@ -75,6 +127,8 @@ struct uv
     queue append_segments;               /* Open segments in use. */
     queue append_pending_reqs;           /* Pending append requests. */
     queue append_writing_reqs;           /* Append requests in flight */
+    void *append_pool;                   /* Free append requests */
+    struct UvWriterContext *writer_ctx;  /* Shared by open segment writers */
     struct UvBarrier *barrier;           /* Inflight barrier request */
     queue finalize_reqs;                 /* Segments waiting to be closed */
     struct uv_work_s finalize_work;      /* Resize and rename segments */
@@ -166,13 +220,17 @@ int uvSegmentLoadAll(struct uv *uv,
  * The memory is aligned at disk block boundary, to allow for direct I/O. */
 struct uvSegmentBuffer
 {
-    size_t block_size; /* Disk block size for direct I/O */
-    uv_buf_t arena;    /* Previously allocated memory that can be re-used */
-    size_t n;          /* Write offset */
+    size_t block_size;        /* Disk block size for direct I/O */
+    uv_buf_t arena;           /* Previously allocated memory to be re-used */
+    size_t n;                 /* Write offset */
+    struct uvArenaPool *pool; /* Pool to get arenas from, or NULL */
 };
 
-/* Initialize an empty buffer. */
-void uvSegmentBufferInit(struct uvSegmentBuffer *b, size_t block_size);
+/* Initialize an empty buffer, which will take its memory from the given pool if
+ * not NULL. */
+void uvSegmentBufferInit(struct uvSegmentBuffer *b,
+                         size_t block_size,
+                         struct uvArenaPool *pool);
 
 /* Release all memory used by the buffer. */
 void uvSegmentBufferClose(struct uvSegmentBuffer *b);
@@ -189,6 +247,36 @@ int uvSegmentBufferAppend(struct uvSegmentBuffer *b,
                           const struct raft_entry entries[],
                           unsigned n_entries);
 
+/* Like uvSegmentBufferAppend(), but only encode the header of the batch, and
+ * leave room for its data, which must be filled using uvSegmentBufferCopy()
+ * before setting its checksum with uvSegmentBufferSetDataChecksum(). The
+ * offset of the batch within the buffer is returned in @offset. */
+int uvSegmentBufferAppendHeader(struct uvSegmentBuffer *b,
+                                const struct raft_entry entries[],
+                                unsigned n_entries,
+                                size_t *offset);
+
+/* Return a pointer to the data section of the batch of @n_entries entries at
+ * the given offset. */
+void *uvSegmentBufferData(struct uvSegmentBuffer *b,
+                          size_t offset,
+                          unsigned n_entries);
+
+/* Copy @len bytes of the data of the given entries, starting from the @start'th
+ * byte of their concatenation, to @data, and return their checksum.
+ *
+ * It only accesses the given memory, so it can be run in a worker thread. */
+unsigned uvSegmentBufferCopy(void *data,
+                             const struct raft_entry entries[],
+                             unsigned n_entries,
+                             size_t start,
+                             size_t len);
+
+/* Set the data checksum of the batch at the given offset. */
+void uvSegmentBufferSetDataChecksum(struct uvSegmentBuffer *b,
+                                    size_t offset,
+                                    unsigned crc);
+
 /* After all entries to write have been encoded, finalize the buffer by zeroing
  * the unused memory of the last block. The out parameter will point to the
  * memory to write. */
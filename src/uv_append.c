@@ -1,6 +1,7 @@
 #include "assert.h"
 #include "byte.h"
 #include "heap.h"
+#include "pool.h"
 #include "queue.h"
 #include "uv.h"
 #include "uv_encoding.h"
@@ -39,6 +40,16 @@
  * callbacks.
  **/
 
+/* Batches whose data is at least this large are copied into the write buffer
+ * and checksummed by threadpool workers, in chunks of this size. */
+#define UV__APPEND_CHUNK_SIZE (1024 * 1024)
+
+/* Maximum number of writes in flight in the completion context shared by open
+ * segments. Further writes are performed in the threadpool. */
+#define UV__APPEND_MAX_WRITES 8
+
+struct uvAppendChunk;
+
 /* An open segment being written or waiting to be written. */
 struct uvAliveSegment
 {
@@ -53,6 +64,9 @@ struct uvAliveSegment
     unsigned next_block;            /* Next segment block to write */
     struct uvSegmentBuffer pending; /* Buffer for data yet to be written */
     uv_buf_t buf;                   /* Write buffer for current write */
+    struct uvAppendChunk *chunks;   /* Data being copied by workers */
+    unsigned n_chunks;              /* Length of the chunks array */
+    unsigned n_copying;             /* Number of chunks still being copied */
     raft_index last_index;          /* Last entry actually written */
     size_t written;                 /* Number of bytes actually written */
     queue queue;                    /* Segment queue */
@@ -66,9 +80,22 @@ struct uvAppend
     const struct raft_entry *entries; /* Entries to write */
     unsigned n;                       /* Number of entries */
     struct uvAliveSegment *segment;   /* Segment to write to */
+    size_t offset;                    /* Offset of the batch in the buffer */
     queue queue;
 };
 
+/* Part of the data of an append request being copied into the write buffer by
+ * a threadpool worker. */
+struct uvAppendChunk
+{
+    struct uvAliveSegment *segment; /* Segment being written */
+    struct uvAppend *append;        /* Append request the data belongs to */
+    size_t start;                   /* Offset of the chunk in the data */
+    size_t len;                     /* Size of the chunk */
+    unsigned crc;                   /* Checksum of the chunk */
+    struct uv_work_s work;          /* Threadpool work request */
+};
+
 static void uvAliveSegmentWriterCloseCb(struct UvWriter *writer)
 {
     struct uvAliveSegment *segment = writer->data;
@@ -120,7 +147,7 @@ static void uvAppendFinishRequestsInQueue(struct uv *uv, queue *q, int status)
         append = QUEUE_DATA(head, struct uvAppend, queue);
         QUEUE_REMOVE(head);
         req = append->req;
-        HeapFree(append);
+        poolPut(&uv->append_pool, append);
         req->cb(req, status);
     }
 }
@@ -151,9 +178,10 @@ static struct uvAliveSegment *uvGetCurrentAliveSegment(struct uv *uv)
     return QUEUE_DATA(head, struct uvAliveSegment, queue);
 }
 
-/* Extend the segment's write buffer by encoding the entries in the given
- * request into it. IOW, previous data in the write buffer will be retained, and
- * data for these new entries will be appended. */
+/* Extend the segment's write buffer by encoding the header of the entries in
+ * the given request into it, leaving room for their data. IOW, previous data in
+ * the write buffer will be retained, and data for these new entries will be
+ * appended. */
 static int uvAliveSegmentEncodeEntriesToWriteBuf(struct uvAliveSegment *segment,
                                                  struct uvAppend *append)
 {
@@ -169,7 +197,8 @@ static int uvAliveSegmentEncodeEntriesToWriteBuf(struct uvAliveSegment *segment,
         }
     }
 
-    rv = uvSegmentBufferAppend(&segment->pending, append->entries, append->n);
+    rv = uvSegmentBufferAppendHeader(&segment->pending, append->entries,
+                                     append->n, &append->offset);
     if (rv != 0) {
         return rv;
     }
@@ -179,11 +208,171 @@ static int uvAliveSegmentEncodeEntriesToWriteBuf(struct uvAliveSegment *segment,
     return 0;
 }
 
+/* Return the total size of the data of the entries in the given request. */
+static size_t uvAppendDataSize(const struct uvAppend *append)
+{
+    size_t size = 0;
+    unsigned i;
+    for (i = 0; i < append->n; i++) {
+        size += append->entries[i].buf.len;
+    }
+    return size;
+}
+
+static int uvAliveSegmentWrite(struct uvAliveSegment *s);
+static void uvAliveSegmentWriteCb(struct UvWriterReq *write, const int status);
+
+/* Set the data checksums of the append requests being written, combining the
+ * checksums of their chunks. */
+static void uvAliveSegmentSetChecksums(struct uvAliveSegment *s)
+{
+    struct uvAppend *append = NULL;
+    unsigned crc = 0;
+    unsigned i;
+
+    for (i = 0; i < s->n_chunks; i++) {
+        struct uvAppendChunk *chunk = &s->chunks[i];
+        if (chunk->append != append) {
+            append = chunk->append;
+            crc = 0;
+        }
+        crc = byteCrc32Combine(crc, chunk->crc, chunk->len);
+        if (i + 1 == s->n_chunks || s->chunks[i + 1].append != append) {
+            uvSegmentBufferSetDataChecksum(&s->pending, append->offset, crc);
+        }
+    }
+
+    HeapFree(s->chunks);
+    s->chunks = NULL;
+    s->n_chunks = 0;
+}
+
+static void uvAppendChunkWorkCb(uv_work_t *work)
+{
+    struct uvAppendChunk *chunk = work->data;
+    struct uvAppend *append = chunk->append;
+    uint8_t *data;
+
+    data = uvSegmentBufferData(&chunk->segment->pending, append->offset,
+                               append->n);
+    chunk->crc = uvSegmentBufferCopy(data + chunk->start, append->entries,
+                                     append->n, chunk->start, chunk->len);
+}
+
+static void uvAppendChunkAfterWorkCb(uv_work_t *work, int status)
+{
+    struct uvAppendChunk *chunk = work->data;
+    struct uvAliveSegment *s = chunk->segment;
+    int rv;
+
+    assert(status == 0); /* We don't cancel worker requests */
+    (void)status;
+
+    assert(s->n_copying > 0);
+    s->n_copying--;
+    if (s->n_copying > 0) {
+        return;
+    }
+
+    uvAliveSegmentSetChecksums(s);
+
+    rv = uvAliveSegmentWrite(s);
+    if (rv != 0) {
+        uvAliveSegmentWriteCb(&s->write, rv);
+    }
+}
+
+/* Copy the data of the append requests being written into the segment's write
+ * buffer. If there is a large amount of data, split it in chunks and copy them
+ * in the threadpool, returning true. In that case the write will be submitted
+ * once all chunks are copied. */
+static bool uvAliveSegmentCopy(struct uvAliveSegment *s, size_t size)
+{
+    struct uv *uv = s->uv;
+    struct uvAppend *append;
+    unsigned n = 0;
+    unsigned i;
+    queue *head;
+    int rv;
+
+    if (size < UV__APPEND_CHUNK_SIZE) {
+        goto sync;
+    }
+
+    QUEUE_FOREACH(head, &uv->append_writing_reqs)
+    {
+        size_t data_size;
+        append = QUEUE_DATA(head, struct uvAppend, queue);
+        data_size = uvAppendDataSize(append);
+        n += (unsigned)((data_size + UV__APPEND_CHUNK_SIZE - 1) /
+                        UV__APPEND_CHUNK_SIZE);
+    }
+
+    s->chunks = HeapCalloc(n, sizeof *s->chunks);
+    if (s->chunks == NULL) {
+        goto sync;
+    }
+    s->n_chunks = n;
+
+    i = 0;
+    QUEUE_FOREACH(head, &uv->append_writing_reqs)
+    {
+        size_t data_size;
+        size_t start;
+        append = QUEUE_DATA(head, struct uvAppend, queue);
+        data_size = uvAppendDataSize(append);
+        for (start = 0; start < data_size; start += UV__APPEND_CHUNK_SIZE) {
+            struct uvAppendChunk *chunk = &s->chunks[i++];
+            chunk->segment = s;
+            chunk->append = append;
+            chunk->start = start;
+            chunk->len = data_size - start;
+            if (chunk->len > UV__APPEND_CHUNK_SIZE) {
+                chunk->len = UV__APPEND_CHUNK_SIZE;
+            }
+            chunk->work.data = chunk;
+        }
+    }
+    assert(i == n);
+
+    /* Count all chunks upfront, so the write doesn't start before the last
+     * one is copied. If a chunk can't be queued, copy it right away. */
+    s->n_copying = n;
+    for (i = 0; i < n; i++) {
+        struct uvAppendChunk *chunk = &s->chunks[i];
+        rv = uv_queue_work(uv->loop, &chunk->work, uvAppendChunkWorkCb,
+                           uvAppendChunkAfterWorkCb);
+        if (rv != 0) {
+            uvAppendChunkWorkCb(&chunk->work);
+            s->n_copying--;
+        }
+    }
+    if (s->n_copying > 0) {
+        return true;
+    }
+
+    uvAliveSegmentSetChecksums(s);
+    return false;
+
+sync:
+    QUEUE_FOREACH(head, &uv->append_writing_reqs)
+    {
+        unsigned crc;
+        append = QUEUE_DATA(head, struct uvAppend, queue);
+        crc = uvSegmentBufferCopy(
+            uvSegmentBufferData(&s->pending, append->offset, append->n),
+            append->entries, append->n, 0, uvAppendDataSize(append));
+        uvSegmentBufferSetDataChecksum(&s->pending, append->offset, crc);
+    }
+    return false;
+}
+
 static int uvAppendMaybeStart(struct uv *uv);
 static void uvAliveSegmentWriteCb(struct UvWriterReq *write, const int status)
 {
     struct uvAliveSegment *s = write->data;
     struct uv *uv = s->uv;
+    struct raft_heap *heap;
     unsigned n_blocks;
     int rv;
 
@@ -266,7 +455,9 @@ out:
 
     /* Possibly process waiting requests. */
     if (!QUEUE_IS_EMPTY(&uv->append_pending_reqs)) {
+        heap = HeapEnter(uv->heap);
         rv = uvAppendMaybeStart(uv);
+        HeapLeave(heap);
         if (rv != 0) {
             uv->errored = true;
         }
@@ -300,6 +491,7 @@ static int uvAppendMaybeStart(struct uv *uv)
     struct uvAliveSegment *segment;
     struct uvAppend *append;
     unsigned n_reqs;
+    size_t size;
     queue *head;
     queue q;
     int rv;
@@ -338,6 +530,7 @@ start:
     QUEUE_INIT(&q);
 
     n_reqs = 0;
+    size = 0;
     while (!QUEUE_IS_EMPTY(&uv->append_pending_reqs)) {
         head = QUEUE_HEAD(&uv->append_pending_reqs);
         append = QUEUE_DATA(head, struct uvAppend, queue);
@@ -352,6 +545,7 @@ start:
         if (rv != 0) {
             goto err;
         }
+        size += uvAppendDataSize(append);
     }
 
     /* If we have no more requests for this segment, let's check if it has been
@@ -377,6 +571,11 @@ start:
         QUEUE_PUSH(&uv->append_writing_reqs, head);
     }
 
+    /* For large batches the write is submitted once copying is done. */
+    if (uvAliveSegmentCopy(segment, size)) {
+        return 0;
+    }
+
     rv = uvAliveSegmentWrite(segment);
     if (rv != 0) {
         goto err;
@@ -398,20 +597,45 @@ static int uvAliveSegmentReady(struct uv *uv,
                                struct uvAliveSegment *segment)
 {
     int rv;
-    rv = UvWriterInit(&segment->writer, uv->loop, fd, uv->direct_io,
-                      uv->async_io, 1, uv->io->errmsg);
+
+    /* All open segments submit their writes through the same completion
+     * context, which is created along with the first of them. */
+    if (uv->writer_ctx == NULL) {
+        uv->writer_ctx = HeapMalloc(sizeof *uv->writer_ctx);
+        if (uv->writer_ctx == NULL) {
+            ErrMsgOom(uv->io->errmsg);
+            rv = RAFT_NOMEM;
+            goto err;
+        }
+        uv->writer_ctx->data = uv;
+        rv = UvWriterContextInit(uv->writer_ctx, uv->loop,
+                                 UV__APPEND_MAX_WRITES, uv->io->errmsg);
+        if (rv != 0) {
+            HeapFree(uv->writer_ctx);
+            uv->writer_ctx = NULL;
+            goto err;
+        }
+    }
+
+    rv = UvWriterInitShared(&segment->writer, uv->writer_ctx, fd,
+                            uv->direct_io, uv->async_io, uv->io->errmsg);
     if (rv != 0) {
-        ErrMsgWrapf(uv->io->errmsg, "setup writer for open-%llu", counter);
-        return rv;
+        goto err;
     }
     segment->counter = counter;
     return 0;
+
+err:
+    assert(rv != 0);
+    ErrMsgWrapf(uv->io->errmsg, "setup writer for open-%llu", counter);
+    return rv;
 }
 
 static void uvAliveSegmentPrepareCb(struct uvPrepare *req, int status)
 {
     struct uvAliveSegment *segment = req->data;
     struct uv *uv = segment->uv;
+    struct raft_heap *heap;
     int rv;
 
     assert(segment->counter == 0);
@@ -438,12 +662,14 @@ static void uvAliveSegmentPrepareCb(struct uvPrepare *req, int status)
      * requests. */
     assert(!QUEUE_IS_EMPTY(&uv->append_pending_reqs));
 
+    heap = HeapEnter(uv->heap);
     rv = uvAliveSegmentReady(uv, req->fd, req->counter, segment);
     if (rv != 0) {
+        HeapLeave(heap);
         goto err;
     }
-
     rv = uvAppendMaybeStart(uv);
+    HeapLeave(heap);
     if (rv != 0) {
         goto err;
     }
@@ -470,7 +696,10 @@ static void uvAliveSegmentInit(struct uvAliveSegment *s, struct uv *uv)
     s->last_index = 0;
     s->size = sizeof(uint64_t) /* Format version */;
     s->next_block = 0;
-    uvSegmentBufferInit(&s->pending, uv->block_size);
+    uvSegmentBufferInit(&s->pending, uv->block_size, &uv->arena_pool);
+    s->chunks = NULL;
+    s->n_chunks = 0;
+    s->n_copying = 0;
     s->written = 0;
     s->barrier = NULL;
     s->finalize = false;
@@ -626,7 +855,7 @@ int UvAppend(struct raft_io *io,
     uv = io->impl;
     assert(!uv->closing);
 
-    append = HeapMalloc(sizeof *append);
+    append = poolGet(&uv->append_pool, sizeof *append);
     if (append == NULL) {
         rv = RAFT_NOMEM;
         goto err;
@@ -653,7 +882,7 @@ int UvAppend(struct raft_io *io,
     return 0;
 
 err_after_req_alloc:
-    HeapFree(append);
+    poolPut(&uv->append_pool, append);
 err:
     assert(rv != 0);
     return rv;
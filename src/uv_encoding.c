@@ -71,6 +71,19 @@ static size_t sizeofTimeoutNow(void)
            sizeof(uint64_t) /* Last log term. */;
 }
 
+static size_t sizeofForward(const struct raft_forward *p)
+{
+    return sizeof(uint64_t) + /* Follower's term. */
+           sizeof(uint64_t) + /* Number of entries in the batch */
+           16 * p->n_entries /* One header per entry */;
+}
+
+static size_t sizeofForwardResult(void)
+{
+    return sizeof(uint64_t) + /* Term of the request. */
+           sizeof(uint64_t) /* Index of the first entry. */;
+}
+
 size_t uvSizeofBatchHeader(size_t n)
 {
     return 8 + /* Number of entries in the batch, little endian */
@@ -157,6 +170,23 @@ static void encodeTimeoutNow(const struct raft_timeout_now *p, void *buf)
     bytePut64(&cursor, p->last_log_term);
 }
 
+static void encodeForward(const struct raft_forward *p, void *buf)
+{
+    void *cursor = buf;
+
+    bytePut64(&cursor, p->term);
+
+    uvEncodeBatchHeader(p->entries, p->n_entries, cursor);
+}
+
+static void encodeForwardResult(const struct raft_forward_result *p, void *buf)
+{
+    void *cursor = buf;
+
+    bytePut64(&cursor, p->term);
+    bytePut64(&cursor, p->index);
+}
+
 int uvEncodeMessage(const struct raft_message *message,
                     uv_buf_t **bufs,
                     unsigned *n_bufs)
@@ -186,6 +216,12 @@ int uvEncodeMessage(const struct raft_message *message,
         case RAFT_IO_TIMEOUT_NOW:
             header.len += sizeofTimeoutNow();
             break;
+        case RAFT_IO_FORWARD:
+            header.len += sizeofForward(&message->forward);
+            break;
+        case RAFT_IO_FORWARD_RESULT:
+            header.len += sizeofForwardResult();
+            break;
         default:
             return RAFT_MALFORMED;
     };
@@ -221,6 +257,12 @@ int uvEncodeMessage(const struct raft_message *message,
         case RAFT_IO_TIMEOUT_NOW:
             encodeTimeoutNow(&message->timeout_now, cursor);
             break;
+        case RAFT_IO_FORWARD:
+            encodeForward(&message->forward, cursor);
+            break;
+        case RAFT_IO_FORWARD_RESULT:
+            encodeForwardResult(&message->forward_result, cursor);
+            break;
     };
 
     *n_bufs = 1;
@@ -230,6 +272,11 @@ int uvEncodeMessage(const struct raft_message *message,
         *n_bufs += message->append_entries.n_entries;
     }
 
+    /* Same for forwarded commands. */
+    if (message->type == RAFT_IO_FORWARD) {
+        *n_bufs += message->forward.n_entries;
+    }
+
     /* For InstallSnapshot request we also send the snapshot payload. */
     if (message->type == RAFT_IO_INSTALL_SNAPSHOT) {
         *n_bufs += 1;
@@ -252,6 +299,15 @@ int uvEncodeMessage(const struct raft_message *message,
         }
     }
 
+    if (message->type == RAFT_IO_FORWARD) {
+        unsigned i;
+        for (i = 0; i < message->forward.n_entries; i++) {
+            const struct raft_entry *entry = &message->forward.entries[i];
+            (*bufs)[i + 1].base = entry->buf.base;
+            (*bufs)[i + 1].len = entry->buf.len;
+        }
+    }
+
     if (message->type == RAFT_IO_INSTALL_SNAPSHOT) {
         (*bufs)[1].base = message->install_snapshot.data.base;
         (*bufs)[1].len = message->install_snapshot.data.len;
@@ -452,6 +508,31 @@ static void decodeTimeoutNow(const uv_buf_t *buf, struct raft_timeout_now *p)
     p->last_log_term = byteGet64(&cursor);
 }
 
+static int decodeForward(const uv_buf_t *buf, struct raft_forward *args)
+{
+    const void *cursor;
+
+    assert(buf != NULL);
+    assert(args != NULL);
+
+    cursor = buf->base;
+
+    args->term = byteGet64(&cursor);
+
+    return uvDecodeBatchHeader(cursor, &args->entries, &args->n_entries);
+}
+
+static void decodeForwardResult(const uv_buf_t *buf,
+                                struct raft_forward_result *p)
+{
+    const void *cursor;
+
+    cursor = buf->base;
+
+    p->term = byteGet64(&cursor);
+    p->index = byteGet64(&cursor);
+}
+
 int uvDecodeMessage(const unsigned long type,
                     const uv_buf_t *header,
                     struct raft_message *message,
@@ -489,6 +570,15 @@ int uvDecodeMessage(const unsigned long type,
         case RAFT_IO_TIMEOUT_NOW:
             decodeTimeoutNow(header, &message->timeout_now);
             break;
+        case RAFT_IO_FORWARD:
+            rv = decodeForward(header, &message->forward);
+            for (i = 0; i < message->forward.n_entries; i++) {
+                *payload_len += message->forward.entries[i].buf.len;
+            }
+            break;
+        case RAFT_IO_FORWARD_RESULT:
+            decodeForwardResult(header, &message->forward_result);
+            break;
         default:
             rv = RAFT_IOERR;
             break;
@@ -3,9 +3,11 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <libgen.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <sys/vfs.h>
@@ -225,3 +227,18 @@ int UvOsSetDirectIo(uv_file fd)
     }
     return 0;
 }
+
+void UvOsAdviseHugePages(void *addr, size_t len)
+{
+#if defined(MADV_HUGEPAGE)
+    uintptr_t mask = ~(uintptr_t)(UV__HUGE_PAGE_SIZE - 1);
+    uintptr_t start = ((uintptr_t)addr + UV__HUGE_PAGE_SIZE - 1) & mask;
+    uintptr_t end = ((uintptr_t)addr + len) & mask;
+    if (start < end) {
+        madvise((void *)start, end - start, MADV_HUGEPAGE);
+    }
+#else
+    (void)addr;
+    (void)len;
+#endif
+}
@@ -116,6 +116,13 @@ int UvOsIoGetevents(aio_context_t ctx,
 int UvOsEventfd(unsigned int initval, int flags);
 int UvOsSetDirectIo(uv_file fd);
 
+/* Size of transparent huge pages. */
+#define UV__HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* Advise the kernel to back the given memory with transparent huge pages, as
+ * far as the huge page boundaries it contains allow. Errors are ignored. */
+void UvOsAdviseHugePages(void *addr, size_t len);
+
 /* Format an error message caused by a failed system call or stdlib function. */
 #define UvOsErrMsg(ERRMSG, SYSCALL, ERRNUM)              \
     {                                                    \
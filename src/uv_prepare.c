@@ -192,6 +192,7 @@ static void uvPrepareAfterWorkCb(uv_work_t *work, int status)
 {
     struct uvIdleSegment *segment = work->data;
     struct uv *uv = segment->uv;
+    struct raft_heap *heap;
     int rv;
     assert(status == 0);
 
@@ -254,7 +255,9 @@ static void uvPrepareAfterWorkCb(uv_work_t *work, int status)
     }
 
     /* Let's start preparing a new open segment. */
+    heap = HeapEnter(uv->heap);
     rv = uvPrepareStart(uv);
+    HeapLeave(heap);
     if (rv != 0) {
         uvPrepareFinishAllRequests(uv, rv);
         uv->errored = true;
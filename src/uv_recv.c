@@ -1,4 +1,6 @@
+#include <stdatomic.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "../include/raft/uv.h"
 #include "assert.h"
@@ -41,11 +43,58 @@
  *
  * - The peer server sends us invalid data. In this case we close the stream
  *   handle and act like above.
+ *
+ * If a dedicated receiving thread is enabled, the accept callback hands the
+ * file descriptor of the new connection over to that thread, which opens a
+ * stream handle on its own loop and runs the steps above, except that received
+ * messages are pushed to a queue instead of being passed to the recv callback.
+ * The raft_io loop is then woken up, and it pops the messages and fires the
+ * recv callback with them.
  */
 
+/* Data exchanged between the raft_io loop and the receiving thread. */
+struct uvRecvItem
+{
+    raft_id id;                  /* ID of the remote server */
+    char *address;               /* Address of the remote server */
+    int fd;                      /* Accepted connection */
+    struct raft_message message; /* Received message */
+};
+
+/* Node of a lock-free single-producer single-consumer queue. */
+struct uvRecvNode
+{
+    _Atomic(struct uvRecvNode *) next;
+    struct uvRecvItem item;
+};
+
+/* The consumer owns the stub node, whose successor is the first item in the
+ * queue, while the producer owns the last node. */
+struct uvRecvQueue
+{
+    struct uvRecvNode *stub; /* Consumer end */
+    struct uvRecvNode *last; /* Producer end */
+};
+
+struct uvRecvThread
+{
+    struct uv *uv;                /* libuv I/O implementation object */
+    uv_thread_t thread;           /* Receiving thread */
+    struct uv_loop_s loop;        /* Loop run by the receiving thread */
+    struct uv_async_s wakeup;     /* Wake up the receiving thread */
+    struct uv_async_s notify;     /* Wake up the raft_io loop */
+    struct uvRecvQueue accepted;  /* Connections for the receiving thread */
+    struct uvRecvQueue received;  /* Messages for the raft_io loop */
+    queue servers;                /* Connections read by the thread */
+    queue aborting;               /* Connections being closed by the thread */
+    atomic_bool stopping;         /* Set by the raft_io loop upon close */
+    atomic_bool done;             /* Set by the thread before exiting */
+};
+
 struct uvServer
 {
     struct uv *uv;               /* libuv I/O implementation object */
+    struct uvRecvThread *thread; /* Receiving thread, or NULL */
     raft_id id;                  /* ID of the remote server */
     char *address;               /* Address of the other server */
     struct uv_stream_s *stream;  /* Connection handle */
@@ -61,11 +110,13 @@ struct uvServer
  * connection. */
 static int uvServerInit(struct uvServer *s,
                         struct uv *uv,
+                        struct uvRecvThread *thread,
                         const raft_id id,
                         const char *address,
                         struct uv_stream_s *stream)
 {
     s->uv = uv;
+    s->thread = thread;
     s->id = id;
     s->address = HeapMalloc(strlen(address) + 1);
     if (s->address == NULL) {
@@ -83,7 +134,7 @@ static int uvServerInit(struct uvServer *s,
     s->message.type = 0;
     s->payload.base = NULL;
     s->payload.len = 0;
-    QUEUE_PUSH(&uv->servers, &s->queue);
+    QUEUE_PUSH(thread != NULL ? &thread->servers : &uv->servers, &s->queue);
     return 0;
 }
 
@@ -98,6 +149,9 @@ static void uvServerDestroy(struct uvServer *s)
             case RAFT_IO_APPEND_ENTRIES:
                 HeapFree(s->message.append_entries.entries);
                 break;
+            case RAFT_IO_FORWARD:
+                HeapFree(s->message.forward.entries);
+                break;
             case RAFT_IO_INSTALL_SNAPSHOT:
                 configurationClose(&s->message.install_snapshot.conf);
                 break;
@@ -111,16 +165,10 @@ static void uvServerDestroy(struct uvServer *s)
     HeapFree(s->stream);
 }
 
-/* Invoked to initialize the read buffer for the next asynchronous read on the
- * socket. */
-static void uvServerAllocCb(uv_handle_t *handle,
-                            size_t suggested_size,
-                            uv_buf_t *buf)
+/* Initialize the read buffer for the next asynchronous read on the socket. */
+static void uvServerAlloc(struct uvServer *s, uv_buf_t *buf)
 {
-    struct uvServer *s = handle->data;
-    (void)suggested_size;
-
-    assert(!s->uv->closing);
+    assert(s->thread != NULL || !s->uv->closing);
 
     /* If this is the first read of the preamble, or of the header, or of the
      * payload, then initialize the read buffer, according to the chunk of data
@@ -161,6 +209,9 @@ static void uvServerAllocCb(uv_handle_t *handle,
             memset(buf, 0, sizeof *buf);
             return;
         }
+        if (s->uv->arena_pool.huge_pages) {
+            UvOsAdviseHugePages(s->payload.base, s->payload.len);
+        }
 
         s->buf = s->payload;
     }
@@ -169,29 +220,134 @@ out:
     *buf = s->buf;
 }
 
+static void uvServerAllocCb(uv_handle_t *handle,
+                            size_t suggested_size,
+                            uv_buf_t *buf)
+{
+    struct uvServer *s = handle->data;
+    struct raft_heap *heap = HeapEnter(s->uv->heap);
+    (void)suggested_size;
+    uvServerAlloc(s, buf);
+    HeapLeave(heap);
+}
+
 /* Callback invoked afer the stream handle of this server connection has been
  * closed. We can release all resources associated with the server object. */
 static void uvServerStreamCloseCb(uv_handle_t *handle)
 {
     struct uvServer *s = handle->data;
     struct uv *uv = s->uv;
+    bool threaded = s->thread != NULL;
     uvServerDestroy(s);
     HeapFree(s);
-    uvMaybeFireCloseCb(uv);
+    if (!threaded) {
+        uvMaybeFireCloseCb(uv);
+    }
 }
 
 static void uvServerAbort(struct uvServer *s)
 {
     struct uv *uv = s->uv;
     QUEUE_REMOVE(&s->queue);
-    QUEUE_PUSH(&uv->aborting, &s->queue);
+    if (s->thread != NULL) {
+        QUEUE_PUSH(&s->thread->aborting, &s->queue);
+    } else {
+        QUEUE_PUSH(&uv->aborting, &s->queue);
+    }
     uv_close((struct uv_handle_s *)s->stream, uvServerStreamCloseCb);
 }
 
-/* Invoke the receive callback. */
-static void uvFireRecvCb(struct uvServer *s)
+/* Initialize a queue with just the stub node. */
+static int uvRecvQueueInit(struct uvRecvQueue *q)
+{
+    q->stub = HeapMalloc(sizeof *q->stub);
+    if (q->stub == NULL) {
+        return RAFT_NOMEM;
+    }
+    atomic_init(&q->stub->next, NULL);
+    q->last = q->stub;
+    return 0;
+}
+
+/* Release all nodes of a queue. The caller must have consumed all items. */
+static void uvRecvQueueClose(struct uvRecvQueue *q)
 {
-    s->uv->recv_cb(s->uv->io, &s->message);
+    assert(atomic_load(&q->stub->next) == NULL);
+    HeapFree(q->stub);
+}
+
+/* Append a copy of the given item to the queue. To be called only by the
+ * producer. */
+static int uvRecvQueuePush(struct uvRecvQueue *q, const struct uvRecvItem *item)
+{
+    struct uvRecvNode *node;
+    node = HeapMalloc(sizeof *node);
+    if (node == NULL) {
+        return RAFT_NOMEM;
+    }
+    atomic_init(&node->next, NULL);
+    node->item = *item;
+    atomic_store_explicit(&q->last->next, node, memory_order_release);
+    q->last = node;
+    return 0;
+}
+
+/* Copy the first item of the queue and remove it, returning false if the queue
+ * is empty. To be called only by the consumer. */
+static bool uvRecvQueuePop(struct uvRecvQueue *q, struct uvRecvItem *item)
+{
+    struct uvRecvNode *next;
+    next = atomic_load_explicit(&q->stub->next, memory_order_acquire);
+    if (next == NULL) {
+        return false;
+    }
+    *item = next->item;
+    HeapFree(q->stub);
+    q->stub = next;
+    return true;
+}
+
+/* Pass the message just received by a server running in the receiving thread
+ * to the raft_io loop. */
+static int uvRecvThreadDeliver(struct uvServer *s)
+{
+    struct uvRecvThread *t = s->thread;
+    struct uvRecvItem item;
+    int rv;
+
+    item.id = s->id;
+    item.address = HeapMalloc(strlen(s->address) + 1);
+    if (item.address == NULL) {
+        return RAFT_NOMEM;
+    }
+    strcpy(item.address, s->address);
+    item.fd = -1;
+    item.message = s->message;
+
+    rv = uvRecvQueuePush(&t->received, &item);
+    if (rv != 0) {
+        HeapFree(item.address);
+        return rv;
+    }
+    uv_async_send(&t->notify);
+
+    return 0;
+}
+
+/* Invoke the receive callback, or pass the message to the raft_io loop if we
+ * are running in the receiving thread. */
+static int uvFireRecvCb(struct uvServer *s)
+{
+    int rv;
+
+    if (s->thread != NULL) {
+        rv = uvRecvThreadDeliver(s);
+        if (rv != 0) {
+            return rv;
+        }
+    } else {
+        s->uv->recv_cb(s->uv->io, &s->message);
+    }
 
     /* Reset our state as we'll start reading a new message. We don't need to
      * release the payload buffer, since ownership was transferred to the
@@ -203,19 +359,16 @@ static void uvFireRecvCb(struct uvServer *s)
     s->header.len = 0;
     s->payload.base = NULL;
     s->payload.len = 0;
+
+    return 0;
 }
 
-/* Callback invoked when data has been read from the socket. */
-static void uvServerReadCb(uv_stream_t *stream,
-                           ssize_t nread,
-                           const uv_buf_t *buf)
+/* Process data that has been read from the socket. */
+static void uvServerRead(struct uvServer *s, ssize_t nread)
 {
-    struct uvServer *s = stream->data;
     int rv;
 
-    (void)buf;
-
-    assert(!s->uv->closing);
+    assert(s->thread != NULL || !s->uv->closing);
 
     /* If the read was successful, let's check if we have received all the data
      * we expected. */
@@ -270,7 +423,10 @@ static void uvServerReadCb(uv_stream_t *stream,
 
             /* If the message has no payload, we're done. */
             if (s->payload.len == 0) {
-                uvFireRecvCb(s);
+                rv = uvFireRecvCb(s);
+                if (rv != 0) {
+                    goto abort;
+                }
             }
         } else {
             /* If we get here it means that we've just completed reading the
@@ -287,6 +443,13 @@ static void uvServerReadCb(uv_stream_t *stream,
                                          s->message.append_entries.entries,
                                          s->message.append_entries.n_entries);
                     break;
+                case RAFT_IO_FORWARD:
+                    payload.base = s->payload.base;
+                    payload.len = s->payload.len;
+                    uvDecodeEntriesBatch(payload.base, 0,
+                                         s->message.forward.entries,
+                                         s->message.forward.n_entries);
+                    break;
                 case RAFT_IO_INSTALL_SNAPSHOT:
                     s->message.install_snapshot.data.base = s->payload.base;
                     break;
@@ -295,7 +458,10 @@ static void uvServerReadCb(uv_stream_t *stream,
                     assert(0);
             }
 
-            uvFireRecvCb(s);
+            rv = uvFireRecvCb(s);
+            if (rv != 0) {
+                goto abort;
+            }
         }
 
         /* Mark that we're done with this chunk. When the alloc callback will
@@ -323,6 +489,17 @@ abort:
     uvServerAbort(s);
 }
 
+static void uvServerReadCb(uv_stream_t *stream,
+                           ssize_t nread,
+                           const uv_buf_t *buf)
+{
+    struct uvServer *s = stream->data;
+    struct raft_heap *heap = HeapEnter(s->uv->heap);
+    (void)buf;
+    uvServerRead(s, nread);
+    HeapLeave(heap);
+}
+
 /* Start reading incoming requests. */
 static int uvServerStart(struct uvServer *s)
 {
@@ -336,6 +513,7 @@ static int uvServerStart(struct uvServer *s)
 }
 
 static int uvAddServer(struct uv *uv,
+                       struct uvRecvThread *thread,
                        raft_id id,
                        const char *address,
                        struct uv_stream_s *stream)
@@ -350,7 +528,7 @@ static int uvAddServer(struct uv *uv,
         goto err;
     }
 
-    rv = uvServerInit(server, uv, id, address, stream);
+    rv = uvServerInit(server, uv, thread, id, address, stream);
     if (rv != 0) {
         goto err_after_server_alloc;
     }
@@ -372,24 +550,352 @@ err:
     return rv;
 }
 
+/* Open a stream handle on the loop of the receiving thread for a connection
+ * handed over by the raft_io loop, and start reading from it. */
+static void uvRecvThreadAddServer(struct uvRecvThread *t,
+                                  struct uvRecvItem *item)
+{
+    struct uv_stream_s *stream;
+    int rv;
+
+    switch (uv_guess_handle(item->fd)) {
+        case UV_TCP:
+            stream = HeapMalloc(sizeof(struct uv_tcp_s));
+            if (stream == NULL) {
+                goto err;
+            }
+            rv = uv_tcp_init(&t->loop, (struct uv_tcp_s *)stream);
+            if (rv != 0) {
+                goto err_after_stream_alloc;
+            }
+            rv = uv_tcp_open((struct uv_tcp_s *)stream, item->fd);
+            break;
+        case UV_NAMED_PIPE:
+            stream = HeapMalloc(sizeof(struct uv_pipe_s));
+            if (stream == NULL) {
+                goto err;
+            }
+            rv = uv_pipe_init(&t->loop, (struct uv_pipe_s *)stream, 0);
+            if (rv != 0) {
+                goto err_after_stream_alloc;
+            }
+            rv = uv_pipe_open((struct uv_pipe_s *)stream, item->fd);
+            break;
+        default:
+            goto err;
+    }
+    if (rv != 0) {
+        goto err_after_stream_init;
+    }
+
+    /* The stream handle owns the file descriptor from now on. */
+    rv = uvAddServer(t->uv, t, item->id, item->address, stream);
+    if (rv != 0) {
+        uv_close((struct uv_handle_s *)stream, (uv_close_cb)HeapFree);
+    }
+    HeapFree(item->address);
+    return;
+
+err_after_stream_init:
+    uv_close((struct uv_handle_s *)stream, (uv_close_cb)HeapFree);
+    goto err;
+err_after_stream_alloc:
+    HeapFree(stream);
+err:
+    close(item->fd);
+    HeapFree(item->address);
+}
+
+/* Invoked in the receiving thread when the raft_io loop has handed over new
+ * connections or has asked the thread to stop. */
+static void uvRecvThreadWakeupCb(struct uv_async_s *wakeup)
+{
+    struct uvRecvThread *t = wakeup->data;
+    struct uvRecvItem item;
+    bool stopping = atomic_load(&t->stopping);
+
+    while (uvRecvQueuePop(&t->accepted, &item)) {
+        if (stopping) {
+            close(item.fd);
+            HeapFree(item.address);
+            continue;
+        }
+        uvRecvThreadAddServer(t, &item);
+    }
+
+    if (!stopping) {
+        return;
+    }
+
+    /* Once all handles are closed the thread's loop will exit. */
+    while (!QUEUE_IS_EMPTY(&t->servers)) {
+        queue *head;
+        head = QUEUE_HEAD(&t->servers);
+        uvServerAbort(QUEUE_DATA(head, struct uvServer, queue));
+    }
+    uv_close((struct uv_handle_s *)wakeup, NULL);
+}
+
+static void uvRecvThreadRun(void *arg)
+{
+    struct uvRecvThread *t = arg;
+    int rv;
+
+    HeapEnter(t->uv->heap);
+    rv = uv_run(&t->loop, UV_RUN_DEFAULT);
+    assert(rv == 0);
+    rv = uv_loop_close(&t->loop);
+    assert(rv == 0);
+    (void)rv;
+
+    atomic_store(&t->done, true);
+    uv_async_send(&t->notify);
+}
+
+/* Release the memory of a message that won't be passed to the recv callback. */
+static void uvRecvDiscard(struct raft_message *message)
+{
+    switch (message->type) {
+        case RAFT_IO_APPEND_ENTRIES:
+            if (message->append_entries.n_entries > 0) {
+                raft_free(message->append_entries.entries[0].batch);
+                raft_free(message->append_entries.entries);
+            }
+            break;
+        case RAFT_IO_FORWARD:
+            if (message->forward.n_entries > 0) {
+                raft_free(message->forward.entries[0].batch);
+                raft_free(message->forward.entries);
+            }
+            break;
+        case RAFT_IO_INSTALL_SNAPSHOT:
+            configurationClose(&message->install_snapshot.conf);
+            raft_free(message->install_snapshot.data.base);
+            break;
+    }
+}
+
+static void uvRecvThreadCloseCb(struct uv_handle_s *handle)
+{
+    struct uvRecvThread *t = handle->data;
+    struct uv *uv = t->uv;
+    struct uvRecvItem item;
+
+    while (uvRecvQueuePop(&t->accepted, &item)) {
+        close(item.fd);
+        HeapFree(item.address);
+    }
+    uvRecvQueueClose(&t->accepted);
+    uvRecvQueueClose(&t->received);
+    HeapFree(t);
+
+    uv->recv_thread = NULL;
+    uvMaybeFireCloseCb(uv);
+}
+
+/* Invoked in the raft_io loop when the receiving thread has passed us new
+ * messages or has exited. */
+static void uvRecvThreadNotifyCb(struct uv_async_s *notify)
+{
+    struct uvRecvThread *t = notify->data;
+    struct uv *uv = t->uv;
+    struct uvRecvItem item;
+    bool done;
+
+    /* Check this before popping, so no message can be pushed afterwards. */
+    done = atomic_load(&t->done);
+
+    while (uvRecvQueuePop(&t->received, &item)) {
+        if (uv->closing) {
+            uvRecvDiscard(&item.message);
+        } else {
+            item.message.server_address = item.address;
+            uv->recv_cb(uv->io, &item.message);
+        }
+        HeapFree(item.address);
+    }
+
+    if (done) {
+        uv_thread_join(&t->thread);
+        uv_close((struct uv_handle_s *)notify, uvRecvThreadCloseCb);
+    }
+}
+
+/* Hand a newly accepted connection over to the receiving thread. */
+static int uvRecvThreadAccept(struct uvRecvThread *t,
+                              raft_id id,
+                              const char *address,
+                              struct uv_stream_s *stream)
+{
+    struct uvRecvItem item;
+    uv_os_fd_t fd;
+    int rv;
+
+    rv = uv_fileno((struct uv_handle_s *)stream, &fd);
+    if (rv != 0) {
+        rv = RAFT_INVALID;
+        goto err;
+    }
+    switch (uv_guess_handle(fd)) {
+        case UV_TCP:
+        case UV_NAMED_PIPE:
+            break;
+        default:
+            rv = RAFT_INVALID;
+            goto err;
+    }
+
+    item.id = id;
+    item.address = HeapMalloc(strlen(address) + 1);
+    if (item.address == NULL) {
+        rv = RAFT_NOMEM;
+        goto err;
+    }
+    strcpy(item.address, address);
+
+    /* The stream handle will close its own file descriptor. */
+    item.fd = dup(fd);
+    if (item.fd == -1) {
+        rv = RAFT_IOERR;
+        goto err_after_address_alloc;
+    }
+
+    rv = uvRecvQueuePush(&t->accepted, &item);
+    if (rv != 0) {
+        goto err_after_dup;
+    }
+    uv_async_send(&t->wakeup);
+
+    uv_close((struct uv_handle_s *)stream, (uv_close_cb)HeapFree);
+
+    return 0;
+
+err_after_dup:
+    close(item.fd);
+err_after_address_alloc:
+    HeapFree(item.address);
+err:
+    assert(rv != 0);
+    return rv;
+}
+
 static void uvRecvAcceptCb(struct raft_uv_transport *transport,
                            raft_id id,
                            const char *address,
                            struct uv_stream_s *stream)
 {
     struct uv *uv = transport->data;
+    struct raft_heap *heap;
     int rv;
     assert(!uv->closing);
-    rv = uvAddServer(uv, id, address, stream);
+    heap = HeapEnter(uv->heap);
+    if (uv->recv_thread != NULL) {
+        rv = uvRecvThreadAccept(uv->recv_thread, id, address, stream);
+        if (rv == 0) {
+            goto out;
+        }
+        /* Fall back to reading the connection in our own loop. */
+        tracef("hand over connection: %s", errCodeToString(rv));
+    }
+    rv = uvAddServer(uv, NULL, id, address, stream);
     if (rv != 0) {
         tracef("add server: %s", errCodeToString(rv));
         uv_close((struct uv_handle_s *)stream, (uv_close_cb)HeapFree);
     }
+out:
+    HeapLeave(heap);
+}
+
+/* Start the receiving thread. */
+static int uvRecvThreadStart(struct uv *uv)
+{
+    struct uvRecvThread *t;
+    int rv;
+
+    t = HeapMalloc(sizeof *t);
+    if (t == NULL) {
+        rv = RAFT_NOMEM;
+        goto err;
+    }
+    t->uv = uv;
+    QUEUE_INIT(&t->servers);
+    QUEUE_INIT(&t->aborting);
+    atomic_init(&t->stopping, false);
+    atomic_init(&t->done, false);
+
+    rv = uvRecvQueueInit(&t->accepted);
+    if (rv != 0) {
+        goto err_after_alloc;
+    }
+    rv = uvRecvQueueInit(&t->received);
+    if (rv != 0) {
+        goto err_after_accepted_init;
+    }
+
+    rv = uv_loop_init(&t->loop);
+    if (rv != 0) {
+        tracef("init receiving loop: %s", uv_strerror(rv));
+        rv = RAFT_IOERR;
+        goto err_after_received_init;
+    }
+    rv = uv_async_init(&t->loop, &t->wakeup, uvRecvThreadWakeupCb);
+    if (rv != 0) {
+        rv = RAFT_IOERR;
+        goto err_after_loop_init;
+    }
+    t->wakeup.data = t;
+    rv = uv_async_init(uv->loop, &t->notify, uvRecvThreadNotifyCb);
+    if (rv != 0) {
+        rv = RAFT_IOERR;
+        goto err_after_wakeup_init;
+    }
+    t->notify.data = t;
+
+    rv = uv_thread_create(&t->thread, uvRecvThreadRun, t);
+    if (rv != 0) {
+        tracef("create receiving thread: %s", uv_strerror(rv));
+        rv = RAFT_IOERR;
+        goto err_after_notify_init;
+    }
+
+    uv->recv_thread = t;
+
+    return 0;
+
+err_after_notify_init:
+    /* The notify handle is closed asynchronously, so let its close callback
+     * release everything else. */
+    uv_close((struct uv_handle_s *)&t->wakeup, NULL);
+    uv_run(&t->loop, UV_RUN_DEFAULT);
+    uv_loop_close(&t->loop);
+    uv->recv_thread = t;
+    uv_close((struct uv_handle_s *)&t->notify, uvRecvThreadCloseCb);
+    return rv;
+err_after_wakeup_init:
+    uv_close((struct uv_handle_s *)&t->wakeup, NULL);
+    uv_run(&t->loop, UV_RUN_DEFAULT);
+err_after_loop_init:
+    uv_loop_close(&t->loop);
+err_after_received_init:
+    uvRecvQueueClose(&t->received);
+err_after_accepted_init:
+    uvRecvQueueClose(&t->accepted);
+err_after_alloc:
+    HeapFree(t);
+err:
+    assert(rv != 0);
+    return rv;
 }
 
 int UvRecvStart(struct uv *uv)
 {
     int rv;
+    if (uv->recv_threaded) {
+        rv = uvRecvThreadStart(uv);
+        if (rv != 0) {
+            return rv;
+        }
+    }
     rv = uv->transport->listen(uv->transport, uvRecvAcceptCb);
     if (rv != 0) {
         return rv;
@@ -406,6 +912,12 @@ void UvRecvClose(struct uv *uv)
         server = QUEUE_DATA(head, struct uvServer, queue);
         uvServerAbort(server);
     }
+    /* If the notify handle is closing the thread is not running anymore. */
+    if (uv->recv_thread != NULL &&
+        !uv_is_closing((struct uv_handle_s *)&uv->recv_thread->notify)) {
+        atomic_store(&uv->recv_thread->stopping, true);
+        uv_async_send(&uv->recv_thread->wakeup);
+    }
 }
 
 #undef tracef
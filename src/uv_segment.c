@@ -624,57 +624,155 @@ err:
     return rv;
 }
 
+static void uvArenaFree(size_t block_size, uv_buf_t *arena)
+{
+    raft_aligned_free(block_size, arena->base);
+}
+
+/* Get an arena of at least @size bytes, either from the pool or by allocating
+ * a new zeroed one. */
+static int uvArenaGet(struct uvArenaPool *p,
+                      size_t block_size,
+                      size_t size,
+                      uv_buf_t *arena)
+{
+    unsigned n = (unsigned)(size / block_size);
+    size_t len;
+    unsigned best = 0;
+    unsigned i;
+
+    /* Pick the smallest arena that is large enough. */
+    if (p != NULL) {
+        for (i = 0; i < p->n; i++) {
+            if (p->arenas[i].len < size) {
+                continue;
+            }
+            if (best == 0 || p->arenas[i].len < p->arenas[best - 1].len) {
+                best = i + 1;
+            }
+        }
+        if (best != 0) {
+            *arena = p->arenas[best - 1];
+            p->arenas[best - 1] = p->arenas[p->n - 1];
+            p->n--;
+            return 0;
+        }
+    }
+
+    if (size % block_size != 0) {
+        n++;
+    }
+    len = block_size * n;
+    if (p != NULL && p->huge_pages && len >= UV__HUGE_PAGE_SIZE) {
+        len = (len + UV__HUGE_PAGE_SIZE - 1) / UV__HUGE_PAGE_SIZE *
+              UV__HUGE_PAGE_SIZE;
+    }
+
+    arena->base = raft_aligned_alloc(block_size, len);
+    if (arena->base == NULL) {
+        return RAFT_NOMEM;
+    }
+    arena->len = len;
+    if (p != NULL && p->huge_pages) {
+        UvOsAdviseHugePages(arena->base, arena->len);
+    }
+    memset(arena->base, 0, len);
+
+    return 0;
+}
+
+/* Return an arena to the pool, or free it if the pool doesn't want it. When the
+ * pool is full, the smallest arena is freed. */
+static void uvArenaPut(struct uvArenaPool *p,
+                       size_t block_size,
+                       uv_buf_t *arena)
+{
+    unsigned smallest = 0;
+    unsigned i;
+
+    if (p == NULL || p->max == 0) {
+        uvArenaFree(block_size, arena);
+        return;
+    }
+    if (p->n < p->max) {
+        p->arenas[p->n++] = *arena;
+        return;
+    }
+    for (i = 1; i < p->n; i++) {
+        if (p->arenas[i].len < p->arenas[smallest].len) {
+            smallest = i;
+        }
+    }
+    if (p->arenas[smallest].len >= arena->len) {
+        uvArenaFree(block_size, arena);
+        return;
+    }
+    uvArenaFree(block_size, &p->arenas[smallest]);
+    p->arenas[smallest] = *arena;
+}
+
+void uvArenaPoolInit(struct uvArenaPool *p)
+{
+    p->max = 0;
+    p->huge_pages = false;
+    p->n = 0;
+}
+
+void uvArenaPoolClose(struct uvArenaPool *p, size_t block_size)
+{
+    unsigned i;
+    for (i = 0; i < p->n; i++) {
+        uvArenaFree(block_size, &p->arenas[i]);
+    }
+    p->n = 0;
+}
+
 /* Ensure that the write buffer of the given segment is large enough to hold the
  * the given number of bytes size. */
 static int uvEnsureSegmentBufferIsLargeEnough(struct uvSegmentBuffer *b,
                                               size_t size)
 {
-    unsigned n = (unsigned)(size / b->block_size);
-    void *base;
-    size_t len;
+    uv_buf_t arena;
+    int rv;
 
     if (b->arena.len >= size) {
         assert(b->arena.base != NULL);
         return 0;
     }
 
-    if (size % b->block_size != 0) {
-        n++;
-    }
-
-    len = b->block_size * n;
-    base = raft_aligned_alloc(b->block_size, len);
-    if (base == NULL) {
-        return RAFT_NOMEM;
+    rv = uvArenaGet(b->pool, b->block_size, size, &arena);
+    if (rv != 0) {
+        return rv;
     }
-    memset(base, 0, len);
 
     /* If the current arena is initialized, we need to copy its content, since
      * it might have data that we want to retain in the next write. */
     if (b->arena.base != NULL) {
         assert(b->arena.len >= b->block_size);
-        memcpy(base, b->arena.base, b->arena.len);
-        raft_aligned_free(b->block_size, b->arena.base);
+        memcpy(arena.base, b->arena.base, b->arena.len);
+        uvArenaPut(b->pool, b->block_size, &b->arena);
     }
 
-    b->arena.base = base;
-    b->arena.len = len;
+    b->arena = arena;
 
     return 0;
 }
 
-void uvSegmentBufferInit(struct uvSegmentBuffer *b, size_t block_size)
+void uvSegmentBufferInit(struct uvSegmentBuffer *b,
+                         size_t block_size,
+                         struct uvArenaPool *pool)
 {
     b->block_size = block_size;
     b->arena.base = NULL;
     b->arena.len = 0;
     b->n = 0;
+    b->pool = pool;
 }
 
 void uvSegmentBufferClose(struct uvSegmentBuffer *b)
 {
     if (b->arena.base != NULL) {
-        raft_aligned_free(b->block_size, b->arena.base);
+        uvArenaPut(b->pool, b->block_size, &b->arena);
     }
 }
 
@@ -695,15 +793,14 @@ int uvSegmentBufferFormat(struct uvSegmentBuffer *b)
     return 0;
 }
 
-int uvSegmentBufferAppend(struct uvSegmentBuffer *b,
-                          const struct raft_entry entries[],
-                          unsigned n_entries)
+int uvSegmentBufferAppendHeader(struct uvSegmentBuffer *b,
+                                const struct raft_entry entries[],
+                                unsigned n_entries,
+                                size_t *offset)
 {
     size_t size;   /* Total size of the batch */
     uint32_t crc1; /* Header checksum */
-    uint32_t crc2; /* Data checksum */
     void *crc1_p;  /* Pointer to header checksum slot */
-    void *crc2_p;  /* Pointer to data checksum slot */
     void *header;  /* Pointer to the header section */
     void *cursor;
     unsigned i;
@@ -719,35 +816,95 @@ int uvSegmentBufferAppend(struct uvSegmentBuffer *b,
     if (rv != 0) {
         return rv;
     }
+    *offset = b->n;
     cursor = b->arena.base + b->n;
 
     /* Placeholder of the checksums */
     crc1_p = cursor;
     bytePut32(&cursor, 0);
-    crc2_p = cursor;
     bytePut32(&cursor, 0);
 
     /* Batch header */
     header = cursor;
     uvEncodeBatchHeader(entries, n_entries, cursor);
     crc1 = byteCrc32(header, uvSizeofBatchHeader(n_entries), 0);
-    cursor = (uint8_t *)cursor + uvSizeofBatchHeader(n_entries);
 
-    /* Batch data */
-    crc2 = 0;
-    for (i = 0; i < n_entries; i++) {
+    bytePut32(&crc1_p, crc1);
+    b->n += size;
+
+    return 0;
+}
+
+void *uvSegmentBufferData(struct uvSegmentBuffer *b,
+                          size_t offset,
+                          unsigned n_entries)
+{
+    return b->arena.base + offset + sizeof(uint32_t) * 2 +
+           uvSizeofBatchHeader(n_entries);
+}
+
+unsigned uvSegmentBufferCopy(void *data,
+                             const struct raft_entry entries[],
+                             unsigned n_entries,
+                             size_t start,
+                             size_t len)
+{
+    uint8_t *cursor = data;
+    unsigned crc = 0;
+    unsigned i;
+
+    for (i = 0; i < n_entries && len > 0; i++) {
         const struct raft_entry *entry = &entries[i];
+        size_t n;
         /* TODO: enforce the requirement of 8-byte alignment also in the
          * higher-level APIs. */
         assert(entry->buf.len % sizeof(uint64_t) == 0);
-        memcpy(cursor, entry->buf.base, entry->buf.len);
-        crc2 = byteCrc32(cursor, entry->buf.len, crc2);
-        cursor = (uint8_t *)cursor + entry->buf.len;
+        if (start >= entry->buf.len) {
+            start -= entry->buf.len;
+            continue;
+        }
+        n = entry->buf.len - start;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(cursor, (uint8_t *)entry->buf.base + start, n);
+        crc = byteCrc32(cursor, n, crc);
+        cursor += n;
+        len -= n;
+        start = 0;
     }
 
-    bytePut32(&crc1_p, crc1);
-    bytePut32(&crc2_p, crc2);
-    b->n += size;
+    return crc;
+}
+
+void uvSegmentBufferSetDataChecksum(struct uvSegmentBuffer *b,
+                                    size_t offset,
+                                    unsigned crc)
+{
+    void *cursor = b->arena.base + offset + sizeof(uint32_t);
+    bytePut32(&cursor, crc);
+}
+
+int uvSegmentBufferAppend(struct uvSegmentBuffer *b,
+                          const struct raft_entry entries[],
+                          unsigned n_entries)
+{
+    size_t offset;
+    size_t len = 0;
+    unsigned crc;
+    unsigned i;
+    int rv;
+
+    rv = uvSegmentBufferAppendHeader(b, entries, n_entries, &offset);
+    if (rv != 0) {
+        return rv;
+    }
+    for (i = 0; i < n_entries; i++) {
+        len += entries[i].buf.len;
+    }
+    crc = uvSegmentBufferCopy(uvSegmentBufferData(b, offset, n_entries),
+                              entries, n_entries, 0, len);
+    uvSegmentBufferSetDataChecksum(b, offset, crc);
 
     return 0;
 }
@@ -909,7 +1066,7 @@ static int uvWriteClosedSegment(struct uv *uv,
         return RAFT_TOOBIG;
     }
 
-    uvSegmentBufferInit(&buf, uv->block_size);
+    uvSegmentBufferInit(&buf, uv->block_size, NULL);
 
     rv = uvSegmentBufferFormat(&buf);
     if (rv != 0) {
@@ -1013,7 +1170,7 @@ int uvSegmentTruncate(struct uv *uv,
     assert(index - segment->first_index < n);
     m = (unsigned)(index - segment->first_index);
 
-    uvSegmentBufferInit(&buf, uv->block_size);
+    uvSegmentBufferInit(&buf, uv->block_size, NULL);
 
     rv = uvSegmentBufferFormat(&buf);
     if (rv != 0) {
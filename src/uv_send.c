@@ -3,6 +3,7 @@
 #include "../include/raft/uv.h"
 #include "assert.h"
 #include "heap.h"
+#include "pool.h"
 #include "uv.h"
 #include "uv_encoding.h"
 
@@ -35,10 +36,24 @@
  * - The write request fails (either synchronously or asynchronously). In this
  *   case we fire the request callback with an error, close the connection
  *   stream, and start a re-connection attempt.
+ *
+ * Messages carrying entries or snapshot data are rejected with RAFT_BUSY while
+ * the stream's write queue exceeds the configured limit, so a slow peer can't
+ * pin an unbounded amount of memory. Other messages are always accepted.
+ *
+ * If the priority channel is enabled, each server has two client objects: one
+ * for messages carrying entries or snapshots and one for all other messages,
+ * so the latter don't wait behind large payloads in the same stream.
+ *
+ * If a send rate is configured, bulk messages (snapshots and large batches of
+ * entries) are subject to a per-peer and a global token bucket. Messages that
+ * exceed the available budget are parked in the client's throttled queue and
+ * written out by a timer once enough tokens have accumulated.
  */
 
-/* Maximum number of requests that can be buffered.  */
-#define UV__CLIENT_MAX_PENDING 3
+/* Messages carrying entries are considered bulk traffic, subject to
+ * throttling, only above this size. */
+#define UV__SEND_BULK_SIZE (64 * 1024)
 
 struct uvClient
 {
@@ -51,7 +66,16 @@ struct uvClient
     raft_id id;                     /* ID of the other server */
     char *address;                  /* Address of the other server */
     queue pending;                  /* Pending send message requests */
+    unsigned n_pending;             /* Number of pending requests */
+    size_t pending_size;            /* Total size of pending requests */
+    struct uv_timer_s throttle;     /* Resume sending throttled requests */
+    struct uvTokenBucket bucket;    /* Per-peer send rate limit */
+    queue throttled;                /* Requests waiting for send tokens */
+    size_t throttled_size;          /* Total size of throttled requests */
     queue queue;                    /* Clients queue */
+    struct uvClient *index_next;    /* Next client in the same index bucket */
+    bool priority;                  /* Whether this is a priority channel */
+    bool congested;                 /* Write queue is above the limit */
     bool closing;                   /* True after calling uvClientAbort */
 };
 
@@ -62,13 +86,18 @@ struct uvSend
     struct raft_io_send *req; /* User request */
     uv_buf_t *bufs;           /* Encoded raft RPC message to send */
     unsigned n_bufs;          /* Number of buffers */
+    size_t size;              /* Total size of the buffers */
+    int type;                 /* Message type */
+    raft_index prev_index;    /* For AppendEntries, index before the entries */
+    unsigned n_entries;       /* For AppendEntries, number of entries */
+    uint64_t throttle_start;  /* Time the request got throttled */
     uv_write_t write;         /* Stream write request */
     queue queue;              /* Pending send requests queue */
 };
 
-/* Free all memory used by the given send request object, including the object
- * itself. */
-static void uvSendDestroy(struct uvSend *s)
+/* Free all memory used by the given send request object, and return the object
+ * itself to the pool. */
+static void uvSendDestroy(struct uv *uv, struct uvSend *s)
 {
     if (s->bufs != NULL) {
         /* Just release the first buffer. Further buffers are entry or snapshot
@@ -78,14 +107,15 @@ static void uvSendDestroy(struct uvSend *s)
         /* Release the buffers array. */
         HeapFree(s->bufs);
     }
-    HeapFree(s);
+    poolPut(&uv->send_pool, s);
 }
 
 /* Initialize a new client associated with the given server. */
 static int uvClientInit(struct uvClient *c,
                         struct uv *uv,
                         raft_id id,
-                        const char *address)
+                        const char *address,
+                        bool priority)
 {
     int rv;
     c->uv = uv;
@@ -101,13 +131,56 @@ static int uvClientInit(struct uvClient *c,
     }
     rv = uv_timer_init(c->uv->loop, &c->timer);
     assert(rv == 0);
+    c->throttle.data = c;
+    rv = uv_timer_init(c->uv->loop, &c->throttle);
+    assert(rv == 0);
     strcpy(c->address, address);
     QUEUE_INIT(&c->pending);
+    c->n_pending = 0;
+    c->pending_size = 0;
+    c->bucket.tokens = 0;
+    c->bucket.time = uv_now(uv->loop);
+    QUEUE_INIT(&c->throttled);
+    c->throttled_size = 0;
+    c->priority = priority;
+    c->congested = false;
     c->closing = false;
     QUEUE_PUSH(&uv->clients, &c->queue);
     return 0;
 }
 
+/* Park a send request until a connection is available. */
+static void uvClientPushPending(struct uvClient *c, struct uvSend *send)
+{
+    QUEUE_PUSH(&c->pending, &send->queue);
+    c->n_pending++;
+    c->pending_size += send->size;
+}
+
+/* Remove a send request from the pending queue. */
+static void uvClientRemovePending(struct uvClient *c, struct uvSend *send)
+{
+    assert(c->n_pending > 0);
+    assert(c->pending_size >= send->size);
+    QUEUE_REMOVE(&send->queue);
+    c->n_pending--;
+    c->pending_size -= send->size;
+}
+
+/* Remove a send request from the pending queue and fail it with the given
+ * status. */
+static void uvClientFailPending(struct uvClient *c,
+                                struct uvSend *send,
+                                int status)
+{
+    struct raft_io_send *req = send->req;
+    uvClientRemovePending(c, send);
+    uvSendDestroy(c->uv, send);
+    if (req->cb != NULL) {
+        req->cb(req, status);
+    }
+}
+
 /* If there's no more pending cleanup, remove the client from the abort queue
  * and destroy it. */
 static void uvClientMaybeDestroy(struct uvClient *c)
@@ -122,19 +195,30 @@ static void uvClientMaybeDestroy(struct uvClient *c)
     if (c->timer.data != NULL) {
         return;
     }
+    if (c->throttle.data != NULL) {
+        return;
+    }
     if (c->old_stream != NULL) {
         return;
     }
 
     while (!QUEUE_IS_EMPTY(&c->pending)) {
+        queue *head;
+        head = QUEUE_HEAD(&c->pending);
+        uvClientFailPending(c, QUEUE_DATA(head, struct uvSend, queue),
+                            RAFT_CANCELED);
+    }
+
+    while (!QUEUE_IS_EMPTY(&c->throttled)) {
         queue *head;
         struct uvSend *send;
         struct raft_io_send *req;
-        head = QUEUE_HEAD(&c->pending);
+        head = QUEUE_HEAD(&c->throttled);
         send = QUEUE_DATA(head, struct uvSend, queue);
         QUEUE_REMOVE(head);
+        c->throttled_size -= send->size;
         req = send->req;
-        uvSendDestroy(send);
+        uvSendDestroy(c->uv, send);
         if (req->cb != NULL) {
             req->cb(req, RAFT_CANCELED);
         }
@@ -200,15 +284,161 @@ static void uvSendWriteCb(struct uv_write_s *write, const int status)
         }
     }
 
-    uvSendDestroy(send);
+    uvSendDestroy(c->uv, send);
 
     if (req->cb != NULL) {
         req->cb(req, cb_status);
     }
 }
 
+/* Write the encoded message of the given request to the client's stream. */
+static int uvClientWrite(struct uvClient *c, struct uvSend *send)
+{
+    int rv;
+    assert(c->stream != NULL);
+    send->write.data = send;
+    rv = uv_write(&send->write, c->stream, send->bufs, send->n_bufs,
+                  uvSendWriteCb);
+    if (rv != 0) {
+        tracef("write message failed -> rv %d", rv);
+        /* UNTESTED: what are the error conditions? perhaps ENOMEM */
+        return RAFT_IOERR;
+    }
+    return 0;
+}
+
+/* Return true if the given request is bulk traffic subject to throttling. */
+static bool uvSendIsBulk(const struct uvSend *send)
+{
+    switch (send->type) {
+        case RAFT_IO_INSTALL_SNAPSHOT:
+            return true;
+        case RAFT_IO_APPEND_ENTRIES:
+            return send->size >= UV__SEND_BULK_SIZE;
+        default:
+            return false;
+    }
+}
+
+/* Refill the given token bucket according to the time elapsed since the last
+ * refill, allowing bursts of at most one second worth of tokens. */
+static void uvTokenBucketRefill(struct uvTokenBucket *b,
+                                size_t rate,
+                                uint64_t now)
+{
+    int64_t burst = (int64_t)rate;
+    if (now > b->time) {
+        b->tokens += (int64_t)(rate * (now - b->time) / 1000);
+        if (b->tokens > burst) {
+            b->tokens = burst;
+        }
+    }
+    b->time = now;
+}
+
+/* Return the number of milliseconds to wait before the given token bucket is
+ * out of debt, or zero if sending is allowed right away. */
+static uint64_t uvTokenBucketDelay(const struct uvTokenBucket *b, size_t rate)
+{
+    if (rate == 0 || b->tokens >= 0) {
+        return 0;
+    }
+    return ((uint64_t)(-b->tokens) * 1000 + rate - 1) / rate;
+}
+
+/* Try to consume @size tokens from both the per-peer and the global buckets.
+ * Return zero on success, or the number of milliseconds to wait otherwise.
+ *
+ * A bucket can go into debt, so messages larger than the bucket size are sent
+ * as soon as the bucket is out of debt. */
+static uint64_t uvClientTakeTokens(struct uvClient *c, size_t size)
+{
+    struct uv *uv = c->uv;
+    uint64_t now = uv_now(uv->loop);
+    uint64_t delay;
+    uint64_t global_delay;
+
+    uvTokenBucketRefill(&c->bucket, uv->send_rate, now);
+    uvTokenBucketRefill(&uv->send_bucket, uv->send_rate_global, now);
+
+    delay = uvTokenBucketDelay(&c->bucket, uv->send_rate);
+    global_delay = uvTokenBucketDelay(&uv->send_bucket, uv->send_rate_global);
+    if (global_delay > delay) {
+        delay = global_delay;
+    }
+    if (delay > 0) {
+        return delay;
+    }
+
+    if (uv->send_rate > 0) {
+        c->bucket.tokens -= (int64_t)size;
+    }
+    if (uv->send_rate_global > 0) {
+        uv->send_bucket.tokens -= (int64_t)size;
+    }
+    return 0;
+}
+
+/* Forward declaration. */
+static void uvClientThrottleCb(uv_timer_t *timer);
+
+/* Write out throttled requests as long as there are enough tokens, possibly
+ * scheduling the throttle timer to resume later. */
+static void uvClientFlushThrottled(struct uvClient *c)
+{
+    struct uv *uv = c->uv;
+    int rv;
+
+    while (!QUEUE_IS_EMPTY(&c->throttled)) {
+        queue *head;
+        struct uvSend *send;
+        struct raft_io_send *req;
+        uint64_t delay;
+
+        head = QUEUE_HEAD(&c->throttled);
+        send = QUEUE_DATA(head, struct uvSend, queue);
+
+        /* If the connection was lost, the request will wait for the next one
+         * in the pending queue. */
+        if (c->stream == NULL) {
+            QUEUE_REMOVE(head);
+            c->throttled_size -= send->size;
+            uvClientPushPending(c, send);
+            continue;
+        }
+
+        delay = uvClientTakeTokens(c, send->size);
+        if (delay > 0) {
+            rv = uv_timer_start(&c->throttle, uvClientThrottleCb, delay, 0);
+            assert(rv == 0);
+            return;
+        }
+
+        QUEUE_REMOVE(head);
+        c->throttled_size -= send->size;
+        uv->throttled_time += uv_now(uv->loop) - send->throttle_start;
+
+        rv = uvClientWrite(c, send);
+        if (rv != 0) {
+            req = send->req;
+            uvSendDestroy(c->uv, send);
+            if (req->cb != NULL) {
+                req->cb(req, rv);
+            }
+        }
+    }
+}
+
+static void uvClientThrottleCb(uv_timer_t *timer)
+{
+    struct uvClient *c = timer->data;
+    tracef("throttle timer expired -> resume sending");
+    uvClientFlushThrottled(c);
+}
+
 static int uvClientSend(struct uvClient *c, struct uvSend *send)
 {
+    struct uv *uv = c->uv;
     int rv;
     assert(!c->closing);
     send->client = c;
@@ -216,21 +446,36 @@ static int uvClientSend(struct uvClient *c, struct uvSend *send)
     /* If there's no connection available, let's queue the request. */
     if (c->stream == NULL) {
         tracef("no connection available -> enqueue message");
-        QUEUE_PUSH(&c->pending, &send->queue);
+        uvClientPushPending(c, send);
         return 0;
     }
 
-    tracef("connection available -> write message");
-    send->write.data = send;
-    rv = uv_write(&send->write, c->stream, send->bufs, send->n_bufs,
-                  uvSendWriteCb);
-    if (rv != 0) {
-        tracef("write message failed -> rv %d", rv);
-        /* UNTESTED: what are the error conditions? perhaps ENOMEM */
-        return RAFT_IOERR;
+    /* If this is bulk traffic and we're over the configured rate, or other
+     * requests are already waiting, let's throttle it. The throttle timer is
+     * always active while there are throttled requests. */
+    if ((uv->send_rate > 0 || uv->send_rate_global > 0) &&
+        uvSendIsBulk(send)) {
+        uint64_t delay = 0;
+        if (QUEUE_IS_EMPTY(&c->throttled)) {
+            delay = uvClientTakeTokens(c, send->size);
+        }
+        if (delay > 0 || !QUEUE_IS_EMPTY(&c->throttled)) {
+            tracef("send rate exceeded -> throttle message");
+            send->throttle_start = uv_now(uv->loop);
+            uv->n_throttled++;
+            QUEUE_PUSH(&c->throttled, &send->queue);
+            c->throttled_size += send->size;
+            if (!uv_is_active((struct uv_handle_s *)&c->throttle)) {
+                rv = uv_timer_start(&c->throttle, uvClientThrottleCb, delay,
+                                    0);
+                assert(rv == 0);
+            }
+            return 0;
+        }
     }
 
-    return 0;
+    tracef("connection available -> write message");
+    return uvClientWrite(c, send);
 }
 
 /* Try to execute all send requests that were blocked in the queue waiting for a
@@ -245,13 +490,13 @@ static void uvClientSendPending(struct uvClient *c)
         struct uvSend *send;
         head = QUEUE_HEAD(&c->pending);
         send = QUEUE_DATA(head, struct uvSend, queue);
-        QUEUE_REMOVE(head);
+        uvClientRemovePending(c, send);
         rv = uvClientSend(c, send);
         if (rv != 0) {
             if (send->req->cb != NULL) {
                 send->req->cb(send->req, rv);
             }
-            uvSendDestroy(send);
+            uvSendDestroy(c->uv, send);
         }
     }
 }
@@ -259,18 +504,80 @@ static void uvClientSendPending(struct uvClient *c)
 static void uvClientTimerCb(uv_timer_t *timer)
 {
     struct uvClient *c = timer->data;
+    struct raft_heap *heap = HeapEnter(c->uv->heap);
     tracef("timer expired -> attempt to reconnect");
     uvClientConnect(c); /* Retry to connect. */
+    HeapLeave(heap);
+}
+
+/* Return true if the information carried by the pending request @old is also
+ * carried by the more recent pending request @new, so @old doesn't need to be
+ * sent anymore. */
+static bool uvSendIsSuperseded(const struct uvSend *old,
+                               const struct uvSend *new)
+{
+    switch (old->type) {
+        case RAFT_IO_APPEND_ENTRIES:
+            if (new->type != RAFT_IO_APPEND_ENTRIES) {
+                return false;
+            }
+            /* Any AppendEntries message also acts as heartbeat. Otherwise the
+             * newer message must include all the entries of the older one. */
+            if (old->n_entries == 0) {
+                return true;
+            }
+            return new->prev_index <= old->prev_index &&
+                   new->prev_index + new->n_entries >=
+                       old->prev_index + old->n_entries;
+        case RAFT_IO_APPEND_ENTRIES_RESULT:
+        case RAFT_IO_REQUEST_VOTE_RESULT:
+            /* Only the most recent result is relevant. */
+            return new->type == old->type;
+        default:
+            return false;
+    }
+}
+
+/* Return true if the pending queue is within the configured limits. */
+static bool uvClientPendingFits(struct uvClient *c)
+{
+    return c->n_pending <= c->uv->send_pending_max &&
+           c->pending_size <= c->uv->send_pending_max_size;
 }
 
-/* Return the number of send requests that we have been parked in the send queue
- * because no connection is available yet. */
-static unsigned uvClientPendingCount(struct uvClient *c)
+/* Shrink the queue of pending requests, by first failing the ones that are
+ * superseded by more recent ones, and then the oldest ones, until it fits the
+ * configured limits. */
+static void uvClientShrinkPending(struct uvClient *c)
 {
     queue *head;
-    unsigned n = 0;
-    QUEUE_FOREACH(head, &c->pending) { n++; }
-    return n;
+    queue *next;
+
+    if (uvClientPendingFits(c)) {
+        return;
+    }
+
+    for (head = QUEUE_HEAD(&c->pending); head != &c->pending; head = next) {
+        struct uvSend *old = QUEUE_DATA(head, struct uvSend, queue);
+        queue *other;
+        next = QUEUE_NEXT(head);
+        for (other = next; other != &c->pending; other = QUEUE_NEXT(other)) {
+            struct uvSend *new = QUEUE_DATA(other, struct uvSend, queue);
+            if (uvSendIsSuperseded(old, new)) {
+                tracef("queue full -> evict superseded message");
+                uvClientFailPending(c, old, RAFT_NOCONNECTION);
+                break;
+            }
+        }
+    }
+
+    while (!uvClientPendingFits(c)) {
+        assert(!QUEUE_IS_EMPTY(&c->pending));
+        tracef("queue full -> evict oldest message");
+        head = QUEUE_HEAD(&c->pending);
+        uvClientFailPending(c, QUEUE_DATA(head, struct uvSend, queue),
+                            RAFT_NOCONNECTION);
+    }
 }
 
 static void uvClientConnectCb(struct raft_uv_connect *req,
@@ -278,7 +585,6 @@ static void uvClientConnectCb(struct raft_uv_connect *req,
                               int status)
 {
     struct uvClient *c = req->data;
-    unsigned n_pending;
     int rv;
 
     tracef("connect attempt completed -> status %s", errCodeToString(status));
@@ -314,25 +620,7 @@ static void uvClientConnectCb(struct raft_uv_connect *req,
         return;
     }
 
-    /* Shrink the queue of pending requests, by failing the oldest ones */
-    n_pending = uvClientPendingCount(c);
-    if (n_pending > UV__CLIENT_MAX_PENDING) {
-        unsigned i;
-        for (i = 0; i < n_pending - UV__CLIENT_MAX_PENDING; i++) {
-            tracef("queue full -> evict oldest message");
-            queue *head;
-            struct uvSend *old_send;
-            struct raft_io_send *old_req;
-            head = QUEUE_HEAD(&c->pending);
-            old_send = QUEUE_DATA(head, struct uvSend, queue);
-            QUEUE_REMOVE(head);
-            old_req = old_send->req;
-            uvSendDestroy(old_send);
-            if (old_req->cb != NULL) {
-                old_req->cb(old_req, RAFT_NOCONNECTION);
-            }
-        }
-    }
+    uvClientShrinkPending(c);
 
     /* Let's schedule another attempt. */
     rv = uv_timer_start(&c->timer, uvClientTimerCb, c->uv->connect_retry_delay,
@@ -365,6 +653,14 @@ static void uvClientConnect(struct uvClient *c)
     }
 }
 
+static void uvClientThrottleCloseCb(struct uv_handle_s *handle)
+{
+    struct uvClient *c = handle->data;
+    assert(handle == (struct uv_handle_s *)&c->throttle);
+    c->throttle.data = NULL;
+    uvClientMaybeDestroy(c);
+}
+
 /* Final callback in the close chain of an io_uv__client object */
 static void uvClientTimerCloseCb(struct uv_handle_s *handle)
 {
@@ -374,6 +670,83 @@ static void uvClientTimerCloseCb(struct uv_handle_s *handle)
     uvClientMaybeDestroy(c);
 }
 
+/* Initial number of buckets of the clients index. */
+#define UV__CLIENTS_INDEX_MIN_SIZE 16
+
+/* Return the bucket of the clients index for the given server ID. */
+static unsigned uvClientsIndexBucket(unsigned size, raft_id id)
+{
+    return (unsigned)((id * 0x9E3779B97F4A7C15ULL) >> 32) & (size - 1);
+}
+
+/* Resize the clients index to the given number of buckets and re-insert all
+ * clients. */
+static int uvClientsIndexResize(struct uv *uv, unsigned size)
+{
+    struct uvClient **index;
+    unsigned i;
+
+    index = HeapCalloc(size, sizeof *index);
+    if (index == NULL) {
+        return RAFT_NOMEM;
+    }
+    for (i = 0; i < uv->clients_index_size; i++) {
+        struct uvClient *c = uv->clients_index[i];
+        while (c != NULL) {
+            struct uvClient *next = c->index_next;
+            unsigned bucket = uvClientsIndexBucket(size, c->id);
+            c->index_next = index[bucket];
+            index[bucket] = c;
+            c = next;
+        }
+    }
+    HeapFree(uv->clients_index);
+    uv->clients_index = index;
+    uv->clients_index_size = size;
+    return 0;
+}
+
+/* Make room in the clients index for one more client, growing it to keep
+ * chains short. */
+static int uvClientsIndexReserve(struct uv *uv)
+{
+    unsigned size;
+    if (uv->n_clients < uv->clients_index_size) {
+        return 0;
+    }
+    size = uv->clients_index_size * 2;
+    if (size < UV__CLIENTS_INDEX_MIN_SIZE) {
+        size = UV__CLIENTS_INDEX_MIN_SIZE;
+    }
+    return uvClientsIndexResize(uv, size);
+}
+
+/* Add a client to the clients index, which must have room for it. */
+static void uvClientsIndexAdd(struct uv *uv, struct uvClient *c)
+{
+    unsigned bucket;
+    assert(uv->n_clients < uv->clients_index_size);
+    bucket = uvClientsIndexBucket(uv->clients_index_size, c->id);
+    c->index_next = uv->clients_index[bucket];
+    uv->clients_index[bucket] = c;
+    uv->n_clients++;
+}
+
+/* Remove a client from the clients index. */
+static void uvClientsIndexRemove(struct uv *uv, struct uvClient *c)
+{
+    struct uvClient **cursor;
+    unsigned bucket;
+    bucket = uvClientsIndexBucket(uv->clients_index_size, c->id);
+    cursor = &uv->clients_index[bucket];
+    while (*cursor != c) {
+        assert(*cursor != NULL);
+        cursor = &(*cursor)->index_next;
+    }
+    *cursor = c->index_next;
+    uv->n_clients--;
+}
+
 /* Start shutting down a client since the raft_io instance has been closed. */
 static void uvClientAbort(struct uvClient *c)
 {
@@ -383,10 +756,12 @@ static void uvClientAbort(struct uvClient *c)
     assert(uv->closing);
     assert(c->stream != NULL || c->old_stream != NULL ||
            uv_is_active((struct uv_handle_s *)&c->timer) ||
+           uv_is_active((struct uv_handle_s *)&c->throttle) ||
            c->connect.data != NULL);
 
     QUEUE_REMOVE(&c->queue);
     QUEUE_PUSH(&uv->aborting, &c->queue);
+    uvClientsIndexRemove(uv, c);
 
     rv = uv_timer_stop(&c->timer);
     assert(rv == 0);
@@ -401,29 +776,66 @@ static void uvClientAbort(struct uvClient *c)
     /* Closing the timer implicitly stop it, so the timeout callback won't be
      * fired. */
     uv_close((struct uv_handle_s *)&c->timer, uvClientTimerCloseCb);
+    uv_close((struct uv_handle_s *)&c->throttle, uvClientThrottleCloseCb);
     c->closing = true;
 }
 
-/* Find the client object associated with the given server, or create one if
- * there's none yet. */
+/* Return true if the given message should be sent using the priority channel,
+ * i.e. it doesn't carry entries or snapshot data. */
+static bool uvSendIsPriority(const struct raft_message *message)
+{
+    switch (message->type) {
+        case RAFT_IO_APPEND_ENTRIES:
+            return message->append_entries.n_entries == 0;
+        case RAFT_IO_INSTALL_SNAPSHOT:
+        case RAFT_IO_FORWARD:
+            return false;
+        default:
+            return true;
+    }
+}
+
+/* Return true if the write queue of the client's stream is above the limit,
+ * using half of the limit as low-water mark to avoid flapping. */
+static bool uvClientIsCongested(struct uvClient *c)
+{
+    size_t limit = c->uv->send_queue_limit;
+    size_t size;
+    if (c->stream == NULL) {
+        c->congested = false;
+        return false;
+    }
+    size = c->stream->write_queue_size + c->throttled_size;
+    if (c->congested) {
+        c->congested = size > limit / 2;
+    } else {
+        c->congested = size > limit;
+    }
+    return c->congested;
+}
+
+/* Find the client object associated with the given server and channel, or
+ * create one if there's none yet. */
 static int uvGetClient(struct uv *uv,
                        const raft_id id,
                        const char *address,
+                       bool priority,
                        struct uvClient **client)
 {
-    queue *head;
     int rv;
 
     /* Check if we already have a client object for this peer server. */
-    QUEUE_FOREACH(head, &uv->clients)
-    {
-        *client = QUEUE_DATA(head, struct uvClient, queue);
-        if ((*client)->id != id) {
-            continue;
+    if (uv->clients_index != NULL) {
+        unsigned bucket = uvClientsIndexBucket(uv->clients_index_size, id);
+        *client = uv->clients_index[bucket];
+        for (; *client != NULL; *client = (*client)->index_next) {
+            if ((*client)->id != id || (*client)->priority != priority) {
+                continue;
+            }
+            /* TODO: handle a change in the address */
+            /* assert(strcmp((*client)->address, address) == 0); */
+            return 0;
         }
-        /* TODO: handle a change in the address */
-        /* assert(strcmp((*client)->address, address) == 0); */
-        return 0;
     }
 
     /* Initialize the new connection */
@@ -433,11 +845,18 @@ static int uvGetClient(struct uv *uv,
         goto err;
     }
 
-    rv = uvClientInit(*client, uv, id, address);
+    rv = uvClientsIndexReserve(uv);
+    if (rv != 0) {
+        goto err_after_client_alloc;
+    }
+
+    rv = uvClientInit(*client, uv, id, address, priority);
     if (rv != 0) {
         goto err_after_client_alloc;
     }
 
+    uvClientsIndexAdd(uv, *client);
+
     /* Make a first connection attempt right away.. */
     uvClientConnect(*client);
 
@@ -458,17 +877,26 @@ int UvSend(struct raft_io *io,
     struct uv *uv = io->impl;
     struct uvSend *send;
     struct uvClient *client;
+    bool priority;
+    unsigned i;
     int rv;
 
     assert(!uv->closing);
 
     /* Allocate a new request object. */
-    send = HeapMalloc(sizeof *send);
+    send = poolGet(&uv->send_pool, sizeof *send);
     if (send == NULL) {
         rv = RAFT_NOMEM;
         goto err;
     }
     send->req = req;
+    send->type = message->type;
+    send->prev_index = 0;
+    send->n_entries = 0;
+    if (message->type == RAFT_IO_APPEND_ENTRIES) {
+        send->prev_index = message->append_entries.prev_log_index;
+        send->n_entries = message->append_entries.n_entries;
+    }
     req->cb = cb;
 
     rv = uvEncodeMessage(message, &send->bufs, &send->n_bufs);
@@ -476,14 +904,27 @@ int UvSend(struct raft_io *io,
         send->bufs = NULL;
         goto err_after_send_alloc;
     }
+    send->size = 0;
+    for (i = 0; i < send->n_bufs; i++) {
+        send->size += send->bufs[i].len;
+    }
 
     /* Get a client object connected to the target server, creating it if it
      * doesn't exist yet. */
-    rv = uvGetClient(uv, message->server_id, message->server_address, &client);
+    priority = uvSendIsPriority(message);
+    rv = uvGetClient(uv, message->server_id, message->server_address,
+                     uv->priority_channel && priority, &client);
     if (rv != 0) {
         goto err_after_send_alloc;
     }
 
+    /* Don't queue more payload data behind a congested connection. */
+    if (!priority && uvClientIsCongested(client)) {
+        tracef("connection congested -> reject message");
+        rv = RAFT_BUSY;
+        goto err_after_send_alloc;
+    }
+
     rv = uvClientSend(client, send);
     if (rv != 0) {
         goto err_after_send_alloc;
@@ -492,7 +933,7 @@ int UvSend(struct raft_io *io,
     return 0;
 
 err_after_send_alloc:
-    uvSendDestroy(send);
+    uvSendDestroy(uv, send);
 err:
     assert(rv != 0);
     return rv;
@@ -508,6 +949,10 @@ void UvSendClose(struct uv *uv)
         client = QUEUE_DATA(head, struct uvClient, queue);
         uvClientAbort(client);
     }
+    assert(uv->n_clients == 0);
+    HeapFree(uv->clients_index);
+    uv->clients_index = NULL;
+    uv->clients_index_size = 0;
 }
 
 #undef tracef
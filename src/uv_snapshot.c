@@ -591,7 +591,11 @@ static void uvSnapshotGetWorkCb(uv_work_t *work)
     size_t n_snapshots;
     struct uvSegmentInfo *segments;
     size_t n_segments;
+    struct raft_heap *heap;
     int rv;
+    /* The loaded snapshot is handed over to the raft instance, so allocate it
+     * from our heap even though we run in a worker thread. */
+    heap = HeapEnter(uv->heap);
     get->status = 0;
     rv = UvList(uv, &snapshots, &n_snapshots, &segments, &n_segments,
                 get->errmsg);
@@ -611,7 +615,7 @@ static void uvSnapshotGetWorkCb(uv_work_t *work)
         HeapFree(segments);
     }
 out:
-    return;
+    HeapLeave(heap);
 }
 
 static void uvSnapshotGetAfterWorkCb(uv_work_t *work, int status)
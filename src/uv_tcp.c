@@ -1,6 +1,9 @@
 #include "uv_tcp.h"
 
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <string.h>
+#include <sys/socket.h>
 
 #include "../include/raft.h"
 #include "../include/raft/uv.h"
@@ -59,6 +62,109 @@ void UvTcpMaybeFireCloseCb(struct UvTcp *t)
     }
 }
 
+/* Set an integer socket option, if non-zero. */
+static int uvTcpSetInt(int fd, int level, int name, int value)
+{
+    int rv;
+    if (value == 0) {
+        return 0;
+    }
+    rv = setsockopt(fd, level, name, &value, sizeof value);
+    if (rv != 0) {
+        return RAFT_IOERR;
+    }
+    return 0;
+}
+
+int UvTcpSetOptions(struct UvTcp *t, struct uv_tcp_s *tcp)
+{
+    struct raft_uv_tcp_options *o = &t->options;
+    uv_os_fd_t fd;
+    int rv;
+
+    rv = uv_fileno((struct uv_handle_s *)tcp, &fd);
+    if (rv != 0) {
+        return RAFT_IOERR;
+    }
+
+    if (o->nodelay) {
+        rv = uv_tcp_nodelay(tcp, 1);
+        if (rv != 0) {
+            return RAFT_IOERR;
+        }
+    }
+    if (o->keepalive > 0) {
+        rv = uv_tcp_keepalive(tcp, 1, o->keepalive);
+        if (rv != 0) {
+            return RAFT_IOERR;
+        }
+    }
+#if defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+    rv = uvTcpSetInt(fd, IPPROTO_TCP, TCP_KEEPINTVL,
+                     (int)o->keepalive_interval);
+    if (rv != 0) {
+        return rv;
+    }
+    rv = uvTcpSetInt(fd, IPPROTO_TCP, TCP_KEEPCNT, (int)o->keepalive_count);
+    if (rv != 0) {
+        return rv;
+    }
+#endif
+#if defined(TCP_QUICKACK)
+    rv = uvTcpSetInt(fd, IPPROTO_TCP, TCP_QUICKACK, o->quickack ? 1 : 0);
+    if (rv != 0) {
+        return rv;
+    }
+#endif
+#if defined(SO_BUSY_POLL)
+    rv = uvTcpSetInt(fd, SOL_SOCKET, SO_BUSY_POLL, o->busy_poll);
+    if (rv != 0) {
+        return rv;
+    }
+#endif
+    rv = uvTcpSetInt(fd, SOL_SOCKET, SO_SNDBUF, o->send_buffer);
+    if (rv != 0) {
+        return rv;
+    }
+    rv = uvTcpSetInt(fd, SOL_SOCKET, SO_RCVBUF, o->recv_buffer);
+    if (rv != 0) {
+        return rv;
+    }
+
+    return 0;
+}
+
+int raft_uv_tcp_set_options(struct raft_uv_transport *transport,
+                            const struct raft_uv_tcp_options *options)
+{
+    struct UvTcp *t = transport->impl;
+#if !defined(TCP_KEEPINTVL) || !defined(TCP_KEEPCNT)
+    if (options->keepalive_interval > 0 || options->keepalive_count > 0) {
+        ErrMsgPrintf(transport->errmsg, "keepalive tuning not supported");
+        return RAFT_INVALID;
+    }
+#endif
+#if !defined(TCP_QUICKACK)
+    if (options->quickack) {
+        ErrMsgPrintf(transport->errmsg, "TCP_QUICKACK not supported");
+        return RAFT_INVALID;
+    }
+#endif
+#if !defined(SO_BUSY_POLL)
+    if (options->busy_poll > 0) {
+        ErrMsgPrintf(transport->errmsg, "SO_BUSY_POLL not supported");
+        return RAFT_INVALID;
+    }
+#endif
+    if (options->send_buffer < 0 || options->recv_buffer < 0 ||
+        options->busy_poll < 0) {
+        ErrMsgPrintf(transport->errmsg, "negative socket option value");
+        return RAFT_INVALID;
+    }
+    t->options = *options;
+    return 0;
+}
+
 int raft_uv_tcp_init(struct raft_uv_transport *transport,
                      struct uv_loop_s *loop)
 {
@@ -82,6 +188,7 @@ int raft_uv_tcp_init(struct raft_uv_transport *transport,
     QUEUE_INIT(&t->aborting);
     t->closing = false;
     t->close_cb = NULL;
+    memset(&t->options, 0, sizeof t->options);
 
     transport->impl = t;
     transport->init = uvTcpInit;
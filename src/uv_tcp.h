@@ -20,6 +20,7 @@ struct UvTcp
     queue aborting;                      /* Connections being aborted */
     bool closing;                        /* True after close() is called */
     raft_uv_transport_close_cb close_cb; /* Call when it's safe to free us */
+    struct raft_uv_tcp_options options;  /* Socket options */
 };
 
 /* Implementation of raft_uv_transport->listen. */
@@ -38,6 +39,10 @@ int UvTcpConnect(struct raft_uv_transport *transport,
 /* Abort all pending connection requests. */
 void UvTcpConnectClose(struct UvTcp *t);
 
+/* Apply the configured socket options to the given TCP handle, which must have
+ * an underlying socket already. */
+int UvTcpSetOptions(struct UvTcp *t, struct uv_tcp_s *tcp);
+
 /* Fire the transport close callback if the transport is closing and there's no
  * more pending callback. */
 void UvTcpMaybeFireCloseCb(struct UvTcp *t);
@@ -173,10 +173,27 @@ static int uvTcpConnectStart(struct uvTcpConnect *r, const char *address)
         goto err_after_encode_handshake;
     }
 
-    rv = uv_tcp_init(r->t->loop, r->tcp);
-    assert(rv == 0);
+    /* Create the socket right away, so options affecting the handshake (such as
+     * buffer sizes) can be set before connecting. */
+    rv = uv_tcp_init_ex(r->t->loop, r->tcp, AF_INET);
+    if (rv != 0) {
+        /* UNTESTED: this should fail only because of lack of system
+         * resources */
+        ErrMsgPrintf(t->transport->errmsg, "uv_tcp_init_ex(): %s",
+                     uv_strerror(rv));
+        HeapFree(r->tcp);
+        rv = RAFT_NOCONNECTION;
+        goto err_after_encode_handshake;
+    }
     r->tcp->data = r;
 
+    rv = UvTcpSetOptions(t, r->tcp);
+    if (rv != 0) {
+        ErrMsgPrintf(t->transport->errmsg, "set socket options failed");
+        rv = RAFT_NOCONNECTION;
+        goto err_after_tcp_init;
+    }
+
     rv = uv_tcp_connect(&r->connect, r->tcp, (struct sockaddr *)&addr,
                         uvTcpConnectUvConnectCb);
     if (rv != 0) {
@@ -226,6 +226,10 @@ static int uvTcpIncomingStart(struct uvTcpIncoming *incoming)
         rv = RAFT_IOERR;
         goto err_after_tcp_init;
     }
+    rv = UvTcpSetOptions(incoming->t, incoming->tcp);
+    if (rv != 0) {
+        goto err_after_tcp_init;
+    }
     rv = uv_read_start((uv_stream_t *)incoming->tcp,
                        uvTcpIncomingAllocCbPreamble,
                        uvTcpIncomingReadCbPreamble);
@@ -293,6 +297,12 @@ int UvTcpListen(struct raft_uv_transport *transport, raft_uv_accept_cb cb)
         /* UNTESTED: what are the error conditions? */
         return RAFT_IOERR;
     }
+    /* Options such as the receive buffer size must be set on the listening
+     * socket to be effective during the handshake of accepted connections. */
+    rv = UvTcpSetOptions(t, &t->listener);
+    if (rv != 0) {
+        return rv;
+    }
     rv = uv_listen((uv_stream_t *)&t->listener, 1, uvTcpListenCb);
     if (rv != 0) {
         /* UNTESTED: what are the error conditions? */
@@ -77,12 +77,27 @@ static void uvWriterWorkCb(uv_work_t *work)
 
     iocbs = &req->iocb;
 
+    /* A shared completion context can't be used to wait for our own write
+     * without consuming the events of the other writers, and setting up a
+     * dedicated context for each write is expensive. Since we are blocking
+     * anyway, just perform a plain write. */
+    if (w->shared) {
+        const uv_buf_t *bufs = *((void **)&req->iocb.aio_buf);
+        rv = UvOsWrite(w->fd, bufs, (unsigned)req->iocb.aio_nbytes,
+                       req->iocb.aio_offset);
+        if (rv < 0) {
+            UvOsErrMsg(req->errmsg, "write", rv);
+        }
+        uvWriterReqSetStatus(req, rv);
+        return;
+    }
+
     /* If more than one write in parallel is allowed, submit the AIO request
      * using a dedicated context, to avoid synchronization issues between
      * threads when multiple writes are submitted in parallel. This is
      * suboptimal but in real-world users should use file systems and kernels
      * with proper async write support. */
-    if (w->n_events > 1) {
+    if (w->context->n_events > 1) {
         ctx = 0;
         rv = uvWriterIoSetup(1 /* Maximum concurrent requests */, &ctx,
                              req->errmsg);
@@ -90,7 +105,7 @@ static void uvWriterWorkCb(uv_work_t *work)
             goto out;
         }
     } else {
-        ctx = w->ctx;
+        ctx = w->context->ctx;
     }
 
     /* Submit the request */
@@ -109,7 +124,7 @@ static void uvWriterWorkCb(uv_work_t *work)
     assert(rv == 0);
 
 out_after_io_setup:
-    if (w->n_events > 1) {
+    if (w->context->n_events > 1) {
         UvOsIoDestroy(ctx);
     }
 
@@ -136,13 +151,13 @@ static void uvWriterAfterWorkCb(uv_work_t *work, int status)
  * ready for reading (i.e. when a write has completed). */
 static void uvWriterPollCb(uv_poll_t *poller, int status, int events)
 {
-    struct UvWriter *w = poller->data;
+    struct UvWriterContext *c = poller->data;
     uint64_t completed; /* True if the write is complete */
     unsigned i;
     int n_events;
     int rv;
 
-    assert(w->event_fd >= 0);
+    assert(c->event_fd >= 0);
 
     /* TODO: it's not clear when polling could fail. In this case we should
      * probably mark all pending requests as failed. */
@@ -151,7 +166,7 @@ static void uvWriterPollCb(uv_poll_t *poller, int status, int events)
     assert(events & UV_READABLE);
 
     /* Read the event file descriptor */
-    rv = (int)read(w->event_fd, &completed, sizeof completed);
+    rv = (int)read(c->event_fd, &completed, sizeof completed);
     if (rv != sizeof completed) {
         /* UNTESTED: According to eventfd(2) this is the only possible failure
          * mode, meaning that epoll has indicated that the event FD is not yet
@@ -167,21 +182,25 @@ static void uvWriterPollCb(uv_poll_t *poller, int status, int events)
      *
      * If we got here at least one write should have completed and io_events
      * should return immediately without blocking. */
-    n_events = UvOsIoGetevents(w->ctx, 1, (long int)w->n_events, w->events, NULL);
+    n_events =
+        UvOsIoGetevents(c->ctx, 1, (long int)c->n_events, c->events, NULL);
     assert(n_events >= 1);
 
     for (i = 0; i < (unsigned)n_events; i++) {
-        struct io_event *event = &w->events[i];
+        struct io_event *event = &c->events[i];
         struct UvWriterReq *req = *((void **)&event->data);
 
 #if defined(RWF_NOWAIT)
         /* If we got EAGAIN, it means it was not possible to perform the write
          * asynchronously, so let's fall back to the threadpool. */
         if (event->res == -EAGAIN) {
+            struct UvWriter *w = req->writer;
             req->iocb.aio_flags &= (unsigned)~IOCB_FLAG_RESFD;
             req->iocb.aio_resfd = 0;
             req->iocb.aio_rw_flags &= ~RWF_NOWAIT;
             assert(req->work.data == NULL);
+            QUEUE_REMOVE(&req->queue);
+            QUEUE_PUSH(&w->work_queue, &req->queue);
             req->work.data = req;
             rv = uv_queue_work(w->loop, &req->work, uvWriterWorkCb,
                                uvWriterAfterWorkCb);
@@ -192,7 +211,7 @@ static void uvWriterPollCb(uv_poll_t *poller, int status, int events)
                 req->status = RAFT_IOERR;
                 goto finish;
             }
-            return;
+            continue;
         }
 #endif /* RWF_NOWAIT */
 
@@ -205,51 +224,34 @@ static void uvWriterPollCb(uv_poll_t *poller, int status, int events)
     }
 }
 
-int UvWriterInit(struct UvWriter *w,
-                 struct uv_loop_s *loop,
-                 uv_file fd,
-                 bool direct /* Whether to use direct I/O */,
-                 bool async /* Whether async I/O is available */,
-                 unsigned max_concurrent_writes,
-                 char *errmsg)
+int UvWriterContextInit(struct UvWriterContext *c,
+                        struct uv_loop_s *loop,
+                        unsigned max_concurrent_writes,
+                        char *errmsg)
 {
-    void *data = w->data;
+    void *data = c->data;
     int rv = 0;
-    memset(w, 0, sizeof *w);
-    w->data = data;
-    w->loop = loop;
-    w->fd = fd;
-    w->async = async;
-    w->ctx = 0;
-    w->events = NULL;
-    w->n_events = max_concurrent_writes;
-    w->event_fd = -1;
-    w->event_poller.data = NULL;
-    w->check.data = NULL;
-    w->close_cb = NULL;
-    QUEUE_INIT(&w->poll_queue);
-    QUEUE_INIT(&w->work_queue);
-    w->closing = false;
-    w->errmsg = errmsg;
-
-    /* Set direct I/O if available. */
-    if (direct) {
-        rv = UvOsSetDirectIo(w->fd);
-        if (rv != 0) {
-            UvOsErrMsg(errmsg, "fcntl", rv);
-            goto err;
-        }
-    }
+    memset(c, 0, sizeof *c);
+    c->data = data;
+    c->loop = loop;
+    c->ctx = 0;
+    c->events = NULL;
+    c->n_events = max_concurrent_writes;
+    c->event_fd = -1;
+    c->event_poller.data = NULL;
+    c->n_writers = 0;
+    c->close_cb = NULL;
+    c->closing = false;
 
     /* Setup the AIO context. */
-    rv = uvWriterIoSetup(w->n_events, &w->ctx, errmsg);
+    rv = uvWriterIoSetup(c->n_events, &c->ctx, errmsg);
     if (rv != 0) {
         goto err;
     }
 
     /* Initialize the array of re-usable event objects. */
-    w->events = HeapCalloc(w->n_events, sizeof *w->events);
-    if (w->events == NULL) {
+    c->events = HeapCalloc(c->n_events, sizeof *c->events);
+    if (c->events == NULL) {
         /* UNTESTED: todo */
         ErrMsgOom(errmsg);
         rv = RAFT_NOMEM;
@@ -265,9 +267,9 @@ int UvWriterInit(struct UvWriter *w,
         rv = RAFT_IOERR;
         goto err_after_events_alloc;
     }
-    w->event_fd = rv;
+    c->event_fd = rv;
 
-    rv = uv_poll_init(loop, &w->event_poller, w->event_fd);
+    rv = uv_poll_init(loop, &c->event_poller, c->event_fd);
     if (rv != 0) {
         /* UNTESTED: with the current libuv implementation this should never
          * fail. */
@@ -275,57 +277,203 @@ int UvWriterInit(struct UvWriter *w,
         rv = RAFT_IOERR;
         goto err_after_event_fd;
     }
-    w->event_poller.data = w;
+    c->event_poller.data = c;
 
-    rv = uv_check_init(loop, &w->check);
+    rv = uv_poll_start(&c->event_poller, UV_READABLE, uvWriterPollCb);
     if (rv != 0) {
         /* UNTESTED: with the current libuv implementation this should never
          * fail. */
-        UvOsErrMsg(errmsg, "uv_check_init", rv);
+        UvOsErrMsg(errmsg, "uv_poll_start", rv);
         rv = RAFT_IOERR;
         goto err_after_event_fd;
     }
-    w->check.data = w;
 
-    rv = uv_poll_start(&w->event_poller, UV_READABLE, uvWriterPollCb);
+    return 0;
+
+err_after_event_fd:
+    UvOsClose(c->event_fd);
+err_after_events_alloc:
+    HeapFree(c->events);
+err_after_io_setup:
+    UvOsIoDestroy(c->ctx);
+err:
+    assert(rv != 0);
+    return rv;
+}
+
+static void uvWriterContextPollerCloseCb(struct uv_handle_s *handle)
+{
+    struct UvWriterContext *c = handle->data;
+    c->event_poller.data = NULL;
+
+    /* This waits for any write still being performed by the kernel. */
+    HeapFree(c->events);
+    UvOsIoDestroy(c->ctx);
+
+    if (c->close_cb != NULL) {
+        c->close_cb(c);
+    }
+}
+
+void UvWriterContextClose(struct UvWriterContext *c, UvWriterContextCloseCb cb)
+{
+    int rv;
+    assert(!c->closing);
+    assert(c->n_writers == 0);
+    c->closing = true;
+    c->close_cb = cb;
+
+    UvOsClose(c->event_fd);
+
+    rv = uv_poll_stop(&c->event_poller);
+    assert(rv == 0); /* Can this ever fail? */
+
+    uv_close((struct uv_handle_s *)&c->event_poller,
+             uvWriterContextPollerCloseCb);
+}
+
+/* Common initialization of private and shared writers. */
+static int uvWriterInit(struct UvWriter *w,
+                        struct UvWriterContext *context,
+                        uv_file fd,
+                        bool direct,
+                        bool async,
+                        char *errmsg)
+{
+    void *data = w->data;
+    int rv = 0;
+    memset(w, 0, sizeof *w);
+    w->data = data;
+    w->loop = context->loop;
+    w->fd = fd;
+    w->async = async;
+    w->context = context;
+    w->shared = false;
+    w->check.data = NULL;
+    w->close_cb = NULL;
+    QUEUE_INIT(&w->poll_queue);
+    QUEUE_INIT(&w->work_queue);
+    w->closing = false;
+    w->errmsg = errmsg;
+
+    /* Set direct I/O if available. */
+    if (direct) {
+        rv = UvOsSetDirectIo(w->fd);
+        if (rv != 0) {
+            UvOsErrMsg(errmsg, "fcntl", rv);
+            goto err;
+        }
+    }
+
+    rv = uv_check_init(w->loop, &w->check);
     if (rv != 0) {
         /* UNTESTED: with the current libuv implementation this should never
          * fail. */
-        UvOsErrMsg(errmsg, "uv_poll_start", rv);
+        UvOsErrMsg(errmsg, "uv_check_init", rv);
         rv = RAFT_IOERR;
-        goto err_after_event_fd;
+        goto err;
     }
+    w->check.data = w;
+    context->n_writers++;
 
     return 0;
 
-err_after_event_fd:
-    UvOsClose(w->event_fd);
-err_after_events_alloc:
-    HeapFree(w->events);
-err_after_io_setup:
-    UvOsIoDestroy(w->ctx);
 err:
     assert(rv != 0);
     return rv;
 }
 
-static void uvWriterCleanUpAndFireCloseCb(struct UvWriter *w)
+static void uvWriterContextFreeCb(struct UvWriterContext *c)
+{
+    HeapFree(c);
+}
+
+int UvWriterInit(struct UvWriter *w,
+                 struct uv_loop_s *loop,
+                 uv_file fd,
+                 bool direct /* Whether to use direct I/O */,
+                 bool async /* Whether async I/O is available */,
+                 unsigned max_concurrent_writes,
+                 char *errmsg)
+{
+    struct UvWriterContext *context;
+    int rv;
+
+    context = HeapMalloc(sizeof *context);
+    if (context == NULL) {
+        ErrMsgOom(errmsg);
+        rv = RAFT_NOMEM;
+        goto err;
+    }
+    context->data = NULL;
+
+    rv = UvWriterContextInit(context, loop, max_concurrent_writes, errmsg);
+    if (rv != 0) {
+        goto err_after_context_alloc;
+    }
+
+    rv = uvWriterInit(w, context, fd, direct, async, errmsg);
+    if (rv != 0) {
+        goto err_after_context_init;
+    }
+
+    return 0;
+
+err_after_context_init:
+    UvWriterContextClose(context, uvWriterContextFreeCb);
+    goto err;
+err_after_context_alloc:
+    HeapFree(context);
+err:
+    assert(rv != 0);
+    return rv;
+}
+
+int UvWriterInitShared(struct UvWriter *w,
+                       struct UvWriterContext *context,
+                       uv_file fd,
+                       bool direct /* Whether to use direct I/O */,
+                       bool async /* Whether async I/O is available */,
+                       char *errmsg)
+{
+    int rv;
+    assert(!context->closing);
+    rv = uvWriterInit(w, context, fd, direct, async, errmsg);
+    if (rv != 0) {
+        return rv;
+    }
+    w->shared = true;
+    return 0;
+}
+
+/* Fire the close callback once both the check handle and, for private writers,
+ * the completion context are closed. */
+static void uvWriterMaybeFireCloseCb(struct UvWriter *w)
 {
     assert(w->closing);
 
+    if (w->check.data != NULL) {
+        return;
+    }
+    if (w->shared) {
+        assert(w->context->n_writers > 0);
+        w->context->n_writers--;
+    } else if (w->context != NULL) {
+        return;
+    }
+
     UvOsClose(w->fd);
-    HeapFree(w->events);
-    UvOsIoDestroy(w->ctx);
 
     if (w->close_cb != NULL) {
         w->close_cb(w);
     }
 }
 
-static void uvWriterPollerCloseCb(struct uv_handle_s *handle)
+static void uvWriterContextCloseCb(struct UvWriterContext *c)
 {
-    struct UvWriter *w = handle->data;
-    w->event_poller.data = NULL;
+    struct UvWriter *w = c->data;
+    HeapFree(c);
+    w->context = NULL;
 
     /* Cancel all pending requests. */
     while (!QUEUE_IS_EMPTY(&w->poll_queue)) {
@@ -338,55 +486,63 @@ static void uvWriterPollerCloseCb(struct uv_handle_s *handle)
         uvWriterReqFinish(req);
     }
 
-    if (w->check.data != NULL) {
-        return;
-    }
-
-    uvWriterCleanUpAndFireCloseCb(w);
+    uvWriterMaybeFireCloseCb(w);
 }
 
 static void uvWriterCheckCloseCb(struct uv_handle_s *handle)
 {
     struct UvWriter *w = handle->data;
     w->check.data = NULL;
-    if (w->event_poller.data != NULL) {
-        return;
+    uvWriterMaybeFireCloseCb(w);
+}
+
+/* Return true if no request is using the writer resources anymore. Requests
+ * pending against a private context get canceled when closing it. */
+static bool uvWriterIsIdle(struct UvWriter *w)
+{
+    if (!QUEUE_IS_EMPTY(&w->work_queue)) {
+        return false;
+    }
+    if (w->shared && !QUEUE_IS_EMPTY(&w->poll_queue)) {
+        return false;
+    }
+    return true;
+}
+
+/* Close the check handle and, if we own it, the completion context. */
+static void uvWriterStop(struct UvWriter *w)
+{
+    uv_close((struct uv_handle_s *)&w->check, uvWriterCheckCloseCb);
+    if (!w->shared) {
+        assert(w->context->n_writers == 1);
+        w->context->n_writers--;
+        w->context->data = w;
+        UvWriterContextClose(w->context, uvWriterContextCloseCb);
     }
-    uvWriterCleanUpAndFireCloseCb(w);
 }
 
 static void uvWriterCheckCb(struct uv_check_s *check)
 {
     struct UvWriter *w = check->data;
-    if (!QUEUE_IS_EMPTY(&w->work_queue)) {
+    if (!uvWriterIsIdle(w)) {
         return;
     }
-    uv_close((struct uv_handle_s *)&w->check, uvWriterCheckCloseCb);
+    uvWriterStop(w);
 }
 
 void UvWriterClose(struct UvWriter *w, UvWriterCloseCb cb)
 {
-    int rv;
     assert(!w->closing);
     w->closing = true;
     w->close_cb = cb;
 
-    /* We can close the event file descriptor right away, but we shouldn't close
-     * the main file descriptor or destroy the AIO context since there might be
-     * threadpool requests in flight. */
-    UvOsClose(w->event_fd);
-
-    rv = uv_poll_stop(&w->event_poller);
-    assert(rv == 0); /* Can this ever fail? */
-
-    uv_close((struct uv_handle_s *)&w->event_poller, uvWriterPollerCloseCb);
-
-    /* If we have requests executing in the threadpool, we need to wait for
-     * them. That's done in the check callback. */
-    if (!QUEUE_IS_EMPTY(&w->work_queue)) {
-        uv_check_start(&w->check, uvWriterCheckCb);
+    /* If we have requests executing in the threadpool, or AIO writes that we
+     * can't cancel, we need to wait for them. That's done in the check
+     * callback. */
+    if (uvWriterIsIdle(w)) {
+        uvWriterStop(w);
     } else {
-        uv_close((struct uv_handle_s *)&w->check, uvWriterCheckCloseCb);
+        uv_check_start(&w->check, uvWriterCheckCb);
     }
 }
 
@@ -417,14 +573,14 @@ int UvWriterSubmit(struct UvWriter *w,
     /* TODO: at the moment we are not leveraging the support for concurrent
      *       writes, so ensure that we're getting write requests
      *       sequentially. */
-    if (w->n_events == 1) {
+    if (w->context->n_events == 1) {
         assert(QUEUE_IS_EMPTY(&w->poll_queue));
         assert(QUEUE_IS_EMPTY(&w->work_queue));
     }
 
     assert(w->fd >= 0);
-    assert(w->event_fd >= 0);
-    assert(w->ctx != 0);
+    assert(w->context->event_fd >= 0);
+    assert(w->context->ctx != 0);
     assert(req != NULL);
     assert(bufs != NULL);
     assert(n > 0);
@@ -463,7 +619,7 @@ int UvWriterSubmit(struct UvWriter *w,
      * without using the threadpool. */
     if (w->async) {
         req->iocb.aio_flags |= IOCB_FLAG_RESFD;
-        req->iocb.aio_resfd = (uint32_t)w->event_fd;
+        req->iocb.aio_resfd = (uint32_t)w->context->event_fd;
         req->iocb.aio_rw_flags |= RWF_NOWAIT;
     }
 #else
@@ -476,7 +632,7 @@ int UvWriterSubmit(struct UvWriter *w,
     /* Try to submit the write request asynchronously */
     if (w->async) {
         QUEUE_PUSH(&w->poll_queue, &req->queue);
-        rv = UvOsIoSubmit(w->ctx, 1, &iocbs);
+        rv = UvOsIoSubmit(w->context->ctx, 1, &iocbs);
 
         /* If no error occurred, we're done, the write request was
          * submitted. */
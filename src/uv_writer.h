@@ -9,6 +9,40 @@
 #include "queue.h"
 #include "uv_os.h"
 
+/* Completion context for asynchronous writes, made of a KAIO context and of
+ * an event file descriptor polled by the loop. It can be shared by several
+ * writers, so that opening a file doesn't need any extra kernel resource. */
+struct UvWriterContext;
+
+/* Callback called after the memory associated with a completion context can be
+ * released. */
+typedef void (*UvWriterContextCloseCb)(struct UvWriterContext *c);
+
+struct UvWriterContext
+{
+    void *data;                      /* User data */
+    struct uv_loop_s *loop;          /* Event loop */
+    aio_context_t ctx;               /* KAIO handle */
+    struct io_event *events;         /* Array of KAIO response objects */
+    unsigned n_events;               /* Length of the events array */
+    int event_fd;                    /* Poll'ed to check if writes finished */
+    struct uv_poll_s event_poller;   /* Poll event_fd for completed writes */
+    unsigned n_writers;              /* Number of writers using the context */
+    UvWriterContextCloseCb close_cb; /* Close callback */
+    bool closing;                    /* Whether we're closing or closed */
+};
+
+/* Initialize a completion context able to track the given number of writes in
+ * flight. Further writes are performed in the threadpool. */
+int UvWriterContextInit(struct UvWriterContext *c,
+                        struct uv_loop_s *loop,
+                        unsigned max_concurrent_writes,
+                        char *errmsg);
+
+/* Release all resources associated with the given context. All writers using
+ * it must have been closed. */
+void UvWriterContextClose(struct UvWriterContext *c, UvWriterContextCloseCb cb);
+
 /* Perform asynchronous writes to a single file. */
 struct UvWriter;
 
@@ -18,24 +52,21 @@ typedef void (*UvWriterCloseCb)(struct UvWriter *w);
 
 struct UvWriter
 {
-    void *data;                    /* User data */
-    struct uv_loop_s *loop;        /* Event loop */
-    uv_file fd;                    /* File handle */
-    bool async;                    /* Whether fully async I/O is supported */
-    aio_context_t ctx;             /* KAIO handle */
-    struct io_event *events;       /* Array of KAIO response objects */
-    unsigned n_events;             /* Length of the events array */
-    int event_fd;                  /* Poll'ed to check if write is finished */
-    struct uv_poll_s event_poller; /* Poll event_fd for completed poll requests */
-    struct uv_check_s check;       /* Check for completed threadpool requests */
-    UvWriterCloseCb close_cb;      /* Close callback */
-    queue poll_queue;              /* Pollable write requests */
-    queue work_queue;              /* Threadpool write requests */
-    bool closing;                  /* Whether we're closing or closed */
-    char *errmsg;                  /* Description of last error */
+    void *data;                      /* User data */
+    struct uv_loop_s *loop;          /* Event loop */
+    uv_file fd;                      /* File handle */
+    bool async;                      /* Whether fully async I/O is supported */
+    struct UvWriterContext *context; /* Completion context */
+    bool shared;                     /* Whether the context is not our own */
+    struct uv_check_s check;         /* Check for completed requests */
+    UvWriterCloseCb close_cb;        /* Close callback */
+    queue poll_queue;                /* Pollable write requests */
+    queue work_queue;                /* Threadpool write requests */
+    bool closing;                    /* Whether we're closing or closed */
+    char *errmsg;                    /* Description of last error */
 };
 
-/* Initialize a file writer. */
+/* Initialize a file writer with its own completion context. */
 int UvWriterInit(struct UvWriter *w,
                  struct uv_loop_s *loop,
                  uv_file fd,
@@ -44,7 +75,19 @@ int UvWriterInit(struct UvWriter *w,
                  unsigned max_concurrent_writes,
                  char *errmsg);
 
-/* Close the given file and release all associated resources. */
+/* Initialize a file writer submitting its writes through the given completion
+ * context, which must be closed only after the writer. */
+int UvWriterInitShared(struct UvWriter *w,
+                       struct UvWriterContext *context,
+                       uv_file fd,
+                       bool direct /* Whether to use direct I/O */,
+                       bool async /* Whether async I/O is available */,
+                       char *errmsg);
+
+/* Close the given file and release all associated resources.
+ *
+ * Pending writes are canceled if the writer has its own completion context,
+ * otherwise the callback is fired only once they are completed. */
 void UvWriterClose(struct UvWriter *w, UvWriterCloseCb cb);
 
 /* Write request. */
@@ -10,6 +10,7 @@
 struct fixture
 {
     FIXTURE_CLUSTER;
+    struct raft_heap instance_heap; /* Heap of the first server. */
 };
 
 static void *setUp(const MunitParameter params[], MUNIT_UNUSED void *user_data)
@@ -29,6 +30,28 @@ static void tearDown(void *data)
     free(f);
 }
 
+/* Like setUp, but the first server uses its own heap. */
+static void *setUpInstanceHeap(const MunitParameter params[],
+                               MUNIT_UNUSED void *user_data)
+{
+    struct fixture *f = munit_malloc(sizeof *f);
+    SETUP_CLUSTER(2);
+    HeapInstanceSetUp(&f->instance_heap);
+    raft_set_heap(CLUSTER_RAFT(0), &f->instance_heap);
+    CLUSTER_BOOTSTRAP;
+    CLUSTER_START;
+    CLUSTER_ELECT(0);
+    return f;
+}
+
+static void tearDownInstanceHeap(void *data)
+{
+    struct fixture *f = data;
+    TEAR_DOWN_CLUSTER;
+    HeapInstanceTearDown(&f->instance_heap);
+    free(f);
+}
+
 /******************************************************************************
  *
  * Helper macros
@@ -112,6 +135,31 @@ TEST(raft_apply, first, setUp, tearDown, 0, NULL)
     return MUNIT_OK;
 }
 
+/* If forwarding is enabled, a follower submits the command to the leader and
+ * the callback fires once the follower has applied it. */
+TEST(raft_apply, forward, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    raft_set_forwarding(CLUSTER_RAFT(1), true);
+    APPLY_SUBMIT(1);
+    APPLY_WAIT;
+    munit_assert_int(FsmGetX(CLUSTER_FSM(1)), ==, 123);
+    munit_assert_int(_req.index, ==, 2);
+    munit_assert_int(CLUSTER_N_SEND(1, RAFT_IO_FORWARD), ==, 1);
+    return MUNIT_OK;
+}
+
+/* The memory allocated by a server with its own heap comes from that heap, and
+ * is returned to it even when released by other code. */
+TEST(raft_apply, instanceHeap, setUpInstanceHeap, tearDownInstanceHeap, 0, NULL)
+{
+    struct fixture *f = data;
+    munit_assert_int(HeapCount(&f->instance_heap), >, 0);
+    APPLY(0);
+    munit_assert_int(FsmGetX(CLUSTER_FSM(0)), ==, 123);
+    return MUNIT_OK;
+}
+
 /******************************************************************************
  *
  * Failure scenarios
@@ -137,3 +185,16 @@ TEST(raft_apply, leadershipLost, setUp, tearDown, 0, NULL)
     APPLY_WAIT;
     return MUNIT_OK;
 }
+
+/* If the leader of a follower forwarding a command goes away, the apply
+ * callback fires with an error. */
+TEST(raft_apply, forwardLeadershipLost, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    raft_set_forwarding(CLUSTER_RAFT(1), true);
+    CLUSTER_KILL(0);
+    APPLY_SUBMIT(1);
+    APPLY_EXPECT(RAFT_LEADERSHIPLOST);
+    APPLY_WAIT;
+    return MUNIT_OK;
+}
@@ -1,5 +1,6 @@
 #include "../../include/raft.h"
 
+#include "../lib/heap.h"
 #include "../lib/runner.h"
 
 /******************************************************************************
@@ -51,3 +52,23 @@ TEST(raft_heap, aligned_alloc, NULL, NULL, 0, NULL)
     raft_free(p);
     return MUNIT_OK;
 }
+
+/* Memory is released to the heap that allocated it, even if the global heap
+ * has changed in the meantime. */
+TEST(raft_heap, freeToOwner, NULL, NULL, 0, NULL)
+{
+    struct raft_heap heap;
+    void *p1;
+    void *p2;
+    HeapInstanceSetUp(&heap);
+    raft_heap_set(&heap);
+    p1 = raft_malloc(8);
+    p2 = raft_aligned_alloc(1024, 2048);
+    raft_heap_set_default();
+    munit_assert_int(HeapCount(&heap), ==, 2);
+    p1 = raft_realloc(p1, 16);
+    raft_free(p1);
+    raft_aligned_free(1024, p2);
+    HeapInstanceTearDown(&heap);
+    return MUNIT_OK;
+}
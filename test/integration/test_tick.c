@@ -27,6 +27,23 @@ static void *setUp(const MunitParameter params[], MUNIT_UNUSED void *user_data)
     return f;
 }
 
+/* Start a cluster of 3 servers with adaptive timeouts enabled and elect the
+ * first one. */
+static void *setUpAdaptive(MUNIT_UNUSED const MunitParameter params[],
+                           MUNIT_UNUSED void *user_data)
+{
+    struct fixture *f = munit_malloc(sizeof *f);
+    unsigned i;
+    SETUP_CLUSTER(3);
+    CLUSTER_BOOTSTRAP;
+    for (i = 0; i < CLUSTER_N; i++) {
+        raft_set_adaptive_timeouts(CLUSTER_RAFT(i), true, 200, 20);
+    }
+    CLUSTER_START;
+    CLUSTER_ELECT(0);
+    return f;
+}
+
 static void tearDown(void *data)
 {
     struct fixture *f = data;
@@ -259,3 +276,44 @@ TEST(tick,
 
     return MUNIT_OK;
 }
+
+/* With adaptive timeouts, the leader sends heartbeats more often than the
+ * configured heartbeat timeout if the round-trip time is low. */
+TEST(tick, adaptiveHeartbeat, setUpAdaptive, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    unsigned n;
+    unsigned i;
+    (void)params;
+
+    for (i = 0; i < CLUSTER_N; i++) {
+        CLUSTER_SET_NETWORK_LATENCY(i, 5);
+    }
+    CLUSTER_STEP_UNTIL_ELAPSED(500);
+
+    n = CLUSTER_N_SEND(0, RAFT_IO_APPEND_ENTRIES);
+    CLUSTER_STEP_UNTIL_ELAPSED(1000);
+
+    /* With a fixed 100 milliseconds heartbeat timeout, about 20 messages would
+     * have been sent to the two followers. */
+    munit_assert_int(CLUSTER_N_SEND(0, RAFT_IO_APPEND_ENTRIES) - n, >, 40);
+    munit_assert_int(CLUSTER_RAFT(0)->rtt, >, 0);
+
+    return MUNIT_OK;
+}
+
+/* With adaptive timeouts, followers detect a failed leader before the
+ * configured election timeout has elapsed if the leader contacts them often. */
+TEST(tick, adaptiveElectionTimeout, setUpAdaptive, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    (void)params;
+
+    CLUSTER_STEP_UNTIL_ELAPSED(1000);
+    munit_assert_int(CLUSTER_RAFT(1)->contact_interval, >, 0);
+
+    CLUSTER_KILL(0);
+    CLUSTER_STEP_UNTIL_STATE_IS(1, RAFT_CANDIDATE, 1000 - 1);
+
+    return MUNIT_OK;
+}
@@ -32,6 +32,24 @@ static bool transferCbHasFired(struct raft_fixture *f, void *arg)
     return *done;
 }
 
+static void shutdownCb(struct raft *r)
+{
+    bool *done = r->data;
+    munit_assert_false(*done);
+    *done = true;
+}
+
+/* Gracefully shutdown the I'th server and wait for it to close. */
+#define SHUTDOWN(I)                                            \
+    do {                                                       \
+        struct raft *__raft = CLUSTER_RAFT(I);                 \
+        bool __done = false;                                   \
+        __raft->data = &__done;                                \
+        raft_shutdown(__raft, shutdownCb);                     \
+        CLUSTER_STEP_UNTIL(transferCbHasFired, &__done, 2000); \
+        CLUSTER_KILL(I);                                       \
+    } while (0)
+
 /* Submit a transfer leadership request against the I'th server. */
 #define TRANSFER_SUBMIT(I, ID)                         \
     struct raft *_raft = CLUSTER_RAFT(I);              \
@@ -190,3 +208,53 @@ TEST(raft_transfer, afterDemotion, setUp, tearDown, 0, NULL)
     munit_assert_int(CLUSTER_LEADER, ==, 1);
     return MUNIT_OK;
 }
+
+/* If a stall threshold is set and a disk write on the leader takes longer than
+ * that, leadership is automatically handed off to an up-to-date voter. */
+TEST(raft_transfer, stallDisk, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_apply req;
+    raft_set_stall_threshold(CLUSTER_RAFT(0), 500);
+    CLUSTER_SET_DISK_LATENCY(0, 1000);
+    CLUSTER_APPLY_ADD_X(0, &req, 1, NULL);
+    CLUSTER_STEP_UNTIL_STATE_IS(0, RAFT_FOLLOWER, 2000);
+    CLUSTER_STEP_UNTIL_HAS_LEADER(1000);
+    munit_assert_int(CLUSTER_LEADER, !=, 0);
+    return MUNIT_OK;
+}
+
+/* If no stall threshold is set, a slow disk write doesn't trigger any
+ * leadership transfer. */
+TEST(raft_transfer, stallDiskDisabled, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_apply req;
+    CLUSTER_SET_DISK_LATENCY(0, 1000);
+    CLUSTER_APPLY_ADD_X(0, &req, 1, NULL);
+    CLUSTER_STEP_UNTIL_ELAPSED(2000);
+    munit_assert_int(CLUSTER_LEADER, ==, 0);
+    return MUNIT_OK;
+}
+
+/* Shutting down the leader gracefully transfers leadership to an up-to-date
+ * voter before closing. */
+TEST(raft_transfer, shutdown, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    CLUSTER_MAKE_PROGRESS;
+    SHUTDOWN(0);
+    munit_assert_int(CLUSTER_STATE(0), ==, RAFT_UNAVAILABLE);
+    munit_assert_int(CLUSTER_STATE(1), ==, RAFT_LEADER);
+    return MUNIT_OK;
+}
+
+/* Shutting down a follower just closes it. */
+TEST(raft_transfer, shutdownFollower, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    SHUTDOWN(1);
+    munit_assert_int(CLUSTER_STATE(1), ==, RAFT_UNAVAILABLE);
+    munit_assert_int(CLUSTER_LEADER, ==, 0);
+    return MUNIT_OK;
+}
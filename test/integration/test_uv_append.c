@@ -259,11 +259,12 @@ TEST(append, finalizeSegment, setUp, tearDown, 0, NULL)
     struct fixture *f = data;
     APPEND(MAX_SEGMENT_BLOCKS, SEGMENT_BLOCK_SIZE);
     APPEND(1, 64);
-    while (!DirHasFile(f->dir, "open-4")) {
+    /* The first segment gets finalized in the threadpool, concurrently with
+     * the preparation of open-4. */
+    while (!DirHasFile(f->dir, "open-4") ||
+           !DirHasFile(f->dir, "0000000000000001-0000000000000004")) {
         LOOP_RUN(1);
     }
-    munit_assert_true(
-        DirHasFile(f->dir, "0000000000000001-0000000000000004"));
     munit_assert_false(DirHasFile(f->dir, "open-1"));
     munit_assert_true(DirHasFile(f->dir, "open-4"));
     return MUNIT_OK;
@@ -417,6 +418,37 @@ TEST(append, resizeArena, setUp, tearDownDeps, 0, NULL)
     return MUNIT_OK;
 }
 
+/* Large batches get copied and checksummed in chunks by threadpool workers,
+ * possibly together with smaller ones. */
+TEST(append, largeBatch, setUp, tearDownDeps, 0, NULL)
+{
+    struct fixture *f = data;
+    APPEND_SUBMIT(0, 1, 64);
+    APPEND_SUBMIT(1, 8, 384 * 1024);
+    APPEND_SUBMIT(2, 1, 64);
+    APPEND_WAIT(0);
+    APPEND_WAIT(1);
+    APPEND_WAIT(2);
+    ASSERT_ENTRIES(10, 64 * 2 + 8 * 384 * 1024);
+    return MUNIT_OK;
+}
+
+/* Write buffers of finalized segments are reused by the following ones. */
+TEST(append, arenaPool, setUp, tearDownDeps, 0, NULL)
+{
+    struct fixture *f = data;
+    raft_uv_set_arena_pool(&f->io, 2, true);
+    APPEND(MAX_SEGMENT_BLOCKS, SEGMENT_BLOCK_SIZE);
+    APPEND(1, 64);
+    APPEND(8, 384 * 1024);
+    APPEND(MAX_SEGMENT_BLOCKS, SEGMENT_BLOCK_SIZE);
+    APPEND(1, 64);
+    ASSERT_ENTRIES(MAX_SEGMENT_BLOCKS * 2 + 10,
+                   MAX_SEGMENT_BLOCKS * SEGMENT_BLOCK_SIZE * 2 + 64 * 2 +
+                       8 * 384 * 1024);
+    return MUNIT_OK;
+}
+
 /* A few append requests get queued, then a truncate request comes in and other
  * append requests right after, before truncation is fully completed. */
 TEST(append, truncate, setUp, tearDown, 0, NULL)
@@ -21,6 +21,7 @@ struct fixture
     FIXTURE_TCP;
     FIXTURE_UV;
     struct peer peer;
+    struct raft_heap io_heap; /* Heap of the backend, if set. */
     bool closed;
 };
 
@@ -112,6 +113,27 @@ static void recvCb(struct raft_io *io, struct raft_message *m1)
             munit_assert_int(m1->timeout_now.last_log_term, ==,
                              m2->timeout_now.last_log_term);
             break;
+        case RAFT_IO_FORWARD:
+            munit_assert_int(m1->forward.term, ==, m2->forward.term);
+            munit_assert_int(m1->forward.n_entries, ==, m2->forward.n_entries);
+            for (i = 0; i < m1->forward.n_entries; i++) {
+                struct raft_entry *entry1 = &m1->forward.entries[i];
+                struct raft_entry *entry2 = &m2->forward.entries[i];
+                munit_assert_int(entry1->type, ==, entry2->type);
+                munit_assert_int(entry1->buf.len, ==, entry2->buf.len);
+                munit_assert_int(
+                    memcmp(entry1->buf.base, entry2->buf.base, entry1->buf.len),
+                    ==, 0);
+            }
+            raft_free(m1->forward.entries[0].batch);
+            raft_free(m1->forward.entries);
+            break;
+        case RAFT_IO_FORWARD_RESULT:
+            munit_assert_int(m1->forward_result.term, ==,
+                             m2->forward_result.term);
+            munit_assert_int(m1->forward_result.index, ==,
+                             m2->forward_result.index);
+            break;
     };
     result->done = true;
 }
@@ -255,6 +277,19 @@ static void *setUp(const MunitParameter params[], void *user_data)
     return f;
 }
 
+/* Like setUp, but with a dedicated receiving thread. */
+static void *setUpThread(const MunitParameter params[], void *user_data)
+{
+    struct fixture *f = setUpDeps(params, user_data);
+    int rv;
+    SETUP_UV;
+    f->io.data = f;
+    raft_uv_set_recv_thread(&f->io, true);
+    rv = f->io.start(&f->io, 10000, NULL, recvCb);
+    munit_assert_int(rv, ==, 0);
+    return f;
+}
+
 static void tearDown(void *data)
 {
     struct fixture *f = data;
@@ -262,6 +297,28 @@ static void tearDown(void *data)
     tearDownDeps(f);
 }
 
+/* Like setUp, but the backend uses its own heap. */
+static void *setUpHeap(const MunitParameter params[], void *user_data)
+{
+    struct fixture *f = setUpDeps(params, user_data);
+    int rv;
+    SETUP_UV;
+    f->io.data = f;
+    HeapInstanceSetUp(&f->io_heap);
+    raft_uv_set_heap(&f->io, &f->io_heap);
+    rv = f->io.start(&f->io, 10000, NULL, recvCb);
+    munit_assert_int(rv, ==, 0);
+    return f;
+}
+
+static void tearDownHeap(void *data)
+{
+    struct fixture *f = data;
+    TEAR_DOWN_UV;
+    HeapInstanceTearDown(&f->io_heap);
+    tearDownDeps(f);
+}
+
 /******************************************************************************
  *
  * raft_io_recv_cb
@@ -410,6 +467,49 @@ TEST(recv, timeoutNow, setUp, tearDown, 0, NULL)
     return MUNIT_OK;
 }
 
+/* Receive a Forward message with two commands. */
+TEST(recv, forward, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_entry entries[2];
+    struct raft_message message;
+    uint8_t data1[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t data2[16] = {8, 7, 6, 5, 4, 3, 2, 1, 8, 7, 6, 5, 4, 3, 2, 1};
+
+    entries[0].term = 2;
+    entries[0].type = RAFT_COMMAND;
+    entries[0].buf.base = data1;
+    entries[0].buf.len = sizeof data1;
+
+    entries[1].term = 2;
+    entries[1].type = RAFT_COMMAND;
+    entries[1].buf.base = data2;
+    entries[1].buf.len = sizeof data2;
+
+    message.type = RAFT_IO_FORWARD;
+    message.forward.term = 2;
+    message.forward.entries = entries;
+    message.forward.n_entries = 2;
+
+    PEER_SEND(&message);
+    RECV(&message);
+
+    return MUNIT_OK;
+}
+
+/* Receive a Forward result message. */
+TEST(recv, forwardResult, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_message message;
+    message.type = RAFT_IO_FORWARD_RESULT;
+    message.forward_result.term = 2;
+    message.forward_result.index = 123;
+    PEER_SEND(&message);
+    RECV(&message);
+    return MUNIT_OK;
+}
+
 /* The handshake fails because of an unexpected protocon version. */
 TEST(recv, badProtocol, setUp, tearDown, 0, NULL)
 {
@@ -468,6 +568,81 @@ TEST(recv, closeBeforeAccept, setUp, tearDownDeps, 0, NULL)
     return MUNIT_OK;
 }
 
+/* Receive messages using a dedicated thread. */
+TEST(recv, thread, setUpThread, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_entry entries[2];
+    struct raft_message message;
+    uint8_t data1[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t data2[16] = {8, 7, 6, 5, 4, 3, 2, 1};
+
+    entries[0].type = RAFT_COMMAND;
+    entries[0].buf.base = data1;
+    entries[0].buf.len = sizeof data1;
+
+    entries[1].type = RAFT_COMMAND;
+    entries[1].buf.base = data2;
+    entries[1].buf.len = sizeof data2;
+
+    message.type = RAFT_IO_APPEND_ENTRIES;
+    message.append_entries.entries = entries;
+    message.append_entries.n_entries = 2;
+
+    PEER_SEND(&message);
+    RECV(&message);
+
+    message.type = RAFT_IO_REQUEST_VOTE;
+    message.request_vote.candidate_id = 2;
+    message.request_vote.last_log_index = 123;
+    message.request_vote.last_log_term = 2;
+    message.request_vote.disrupt_leader = false;
+    PEER_SEND(&message);
+    RECV(&message);
+
+    return MUNIT_OK;
+}
+
+/* Incoming connections and messages are allocated from the heap of the backend
+ * and released back to it. */
+TEST(recv, heap, setUpHeap, tearDownHeap, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_entry entry;
+    struct raft_message message;
+    uint8_t data1[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    entry.type = RAFT_COMMAND;
+    entry.buf.base = data1;
+    entry.buf.len = sizeof data1;
+
+    message.type = RAFT_IO_APPEND_ENTRIES;
+    message.append_entries.entries = &entry;
+    message.append_entries.n_entries = 1;
+
+    munit_assert_int(HeapCount(&f->io_heap), ==, 0);
+    PEER_SEND(&message);
+    RECV(&message);
+    munit_assert_int(HeapCount(&f->io_heap), >, 0);
+
+    return MUNIT_OK;
+}
+
+/* The backend is closed while the receiving thread is reading a message. */
+TEST(recv, threadCloseWhileReading, setUpThread, tearDownDeps, 0, NULL)
+{
+    struct fixture *f = data;
+    uint8_t header[] = {
+        1, 0, 0, 0, 0, 0, 0, 0, /* Message type */
+        4, 0, 0, 0, 0, 0, 0, 0  /* Message size */
+    };
+    PEER_HANDSHAKE;
+    TCP_CLIENT_SEND(header, sizeof header);
+    LOOP_RUN(1);
+    TEAR_DOWN_UV;
+    return MUNIT_OK;
+}
+
 /* The backend is closed after receiving the header of an AppendEntries
  * message. */
 TEST(recv, closeAfterAppendEntriesHeader, setUp, tearDown, 0, NULL)
@@ -214,6 +214,121 @@ TEST(send, appendEntriesResult, setUp, tearDown, 0, NULL)
     return MUNIT_OK;
 }
 
+/* If the priority channel is enabled, messages carrying entries and control
+ * messages are sent over two different connections. */
+TEST(send, priorityChannel, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_entry entries[1];
+    int socket1;
+    int socket2;
+
+    raft_uv_set_priority_channel(&f->io, true);
+
+    entries[0].buf.base = raft_malloc(16);
+    entries[0].buf.len = 16;
+
+    MESSAGE(0)->type = RAFT_IO_APPEND_ENTRIES;
+    MESSAGE(0)->append_entries.entries = entries;
+    MESSAGE(0)->append_entries.n_entries = 1;
+    MESSAGE(1)->type = RAFT_IO_APPEND_ENTRIES;
+    MESSAGE(1)->append_entries.entries = NULL;
+    MESSAGE(1)->append_entries.n_entries = 0;
+
+    SEND(0);
+    SEND(1);
+
+    /* Both connections were established. */
+    socket1 = TcpServerAccept(&f->server);
+    socket2 = TcpServerAccept(&f->server);
+    munit_assert_int(socket1, !=, socket2);
+    close(socket1);
+    close(socket2);
+
+    raft_free(entries[0].buf.base);
+
+    return MUNIT_OK;
+}
+
+/* Messages carrying entries are rejected while the connection is congested,
+ * while other messages are still accepted. */
+TEST(send, congested, setUp, tearDownDeps, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_entry entries[1];
+
+    raft_uv_set_send_queue_limit(&f->io, 1024);
+
+    /* Establish the connection. */
+    SEND(0);
+
+    /* Set a very large message that is likely to fill the socket buffer,
+     * since the server never reads. */
+    entries[0].buf.len = 1024 * 1024 * 16;
+    entries[0].buf.base = raft_malloc(entries[0].buf.len);
+    MESSAGE(1)->type = RAFT_IO_APPEND_ENTRIES;
+    MESSAGE(1)->append_entries.entries = entries;
+    MESSAGE(1)->append_entries.n_entries = 1;
+    SEND_SUBMIT(1 /* message */, 0 /* rv */, RAFT_CANCELED /* status */);
+
+    MESSAGE(2)->type = RAFT_IO_APPEND_ENTRIES;
+    MESSAGE(2)->append_entries.entries = entries;
+    MESSAGE(2)->append_entries.n_entries = 1;
+    SEND_ERROR(2, RAFT_BUSY, "");
+
+    MESSAGE(3)->type = RAFT_IO_APPEND_ENTRIES;
+    MESSAGE(3)->append_entries.entries = NULL;
+    MESSAGE(3)->append_entries.n_entries = 0;
+    SEND_SUBMIT(3 /* message */, 0 /* rv */, RAFT_CANCELED /* status */);
+
+    TEAR_DOWN_UV;
+
+    raft_free(entries[0].buf.base);
+
+    return MUNIT_OK;
+}
+
+/* Bulk messages exceeding the configured send rate are delayed. */
+TEST(send, throttle, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_entry entries[1];
+    unsigned long long n;
+    unsigned long long msecs;
+
+    raft_uv_set_send_rate(&f->io, 10 * 1024 * 1024, 0);
+
+    /* Establish the connection. */
+    SEND(0);
+
+    entries[0].buf.len = 256 * 1024;
+    entries[0].buf.base = raft_malloc(entries[0].buf.len);
+    MESSAGE(1)->type = RAFT_IO_APPEND_ENTRIES;
+    MESSAGE(1)->append_entries.entries = entries;
+    MESSAGE(1)->append_entries.n_entries = 1;
+    MESSAGE(2)->type = RAFT_IO_APPEND_ENTRIES;
+    MESSAGE(2)->append_entries.entries = entries;
+    MESSAGE(2)->append_entries.n_entries = 1;
+
+    /* The first message consumes the whole budget, so the second one has to
+     * wait. Control messages are not affected. */
+    SEND_SUBMIT(1 /* message */, 0 /* rv */, 0 /* status */);
+    SEND_SUBMIT(2 /* message */, 0 /* rv */, 0 /* status */);
+    SEND(3);
+    raft_uv_throttle_stats(&f->io, &n, &msecs);
+    munit_assert_int(n, ==, 1);
+
+    SEND_WAIT(1);
+    SEND_WAIT(2);
+    raft_uv_throttle_stats(&f->io, &n, &msecs);
+    munit_assert_int(n, ==, 1);
+    munit_assert_int(msecs, >, 0);
+
+    raft_free(entries[0].buf.base);
+
+    return MUNIT_OK;
+}
+
 /* Send an install snapshot message. */
 TEST(send, installSnapshot, setUp, tearDown, 0, NULL)
 {
@@ -283,6 +398,52 @@ TEST(send, evictOldPending, setUp, tearDownDeps, 0, NULL)
     return MUNIT_OK;
 }
 
+/* When evicting pending requests, the ones superseded by more recent requests
+ * are evicted first. */
+TEST(send, evictSupersededPending, setUp, tearDownDeps, 0, NULL)
+{
+    struct fixture *f = data;
+    raft_uv_set_send_pending_limit(&f->io, 2, 1024 * 1024);
+    MESSAGE(0)->type = RAFT_IO_APPEND_ENTRIES;
+    MESSAGE(0)->append_entries.prev_log_index = 1;
+    MESSAGE(0)->append_entries.entries = NULL;
+    MESSAGE(0)->append_entries.n_entries = 0;
+    MESSAGE(2)->type = RAFT_IO_APPEND_ENTRIES;
+    MESSAGE(2)->append_entries.prev_log_index = 1;
+    MESSAGE(2)->append_entries.entries = NULL;
+    MESSAGE(2)->append_entries.n_entries = 0;
+    TCP_SERVER_STOP;
+    SEND_SUBMIT(0 /* message */, 0 /* rv */, RAFT_NOCONNECTION /* status */);
+    SEND_SUBMIT(1 /* message */, 0 /* rv */, RAFT_CANCELED /* status */);
+    SEND_SUBMIT(2 /* message */, 0 /* rv */, RAFT_CANCELED /* status */);
+    SEND_WAIT(0);
+    TEAR_DOWN_UV;
+    return MUNIT_OK;
+}
+
+/* Pending requests are also evicted when their total size exceeds the
+ * configured limit. */
+TEST(send, evictPendingBySize, setUp, tearDownDeps, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_entry entries[1];
+    entries[0].buf.len = 4096;
+    entries[0].buf.base = raft_malloc(entries[0].buf.len);
+    raft_uv_set_send_pending_limit(&f->io, 10, 1024);
+    MESSAGE(1)->type = RAFT_IO_APPEND_ENTRIES;
+    MESSAGE(1)->append_entries.prev_log_index = 1;
+    MESSAGE(1)->append_entries.entries = entries;
+    MESSAGE(1)->append_entries.n_entries = 1;
+    TCP_SERVER_STOP;
+    SEND_SUBMIT(0 /* message */, 0 /* rv */, RAFT_NOCONNECTION /* status */);
+    SEND_SUBMIT(1 /* message */, 0 /* rv */, RAFT_NOCONNECTION /* status */);
+    SEND_SUBMIT(2 /* message */, 0 /* rv */, RAFT_CANCELED /* status */);
+    SEND_WAIT(1);
+    TEAR_DOWN_UV;
+    raft_free(entries[0].buf.base);
+    return MUNIT_OK;
+}
+
 /* After the connection is established the peer dies and then comes back a
  * little bit later. */
 TEST(send, reconnectAfterWriteError, setUp, tearDown, 0, NULL)
@@ -176,6 +176,38 @@ TEST(tcp_connect, first, setUp, tearDown, 0, NULL)
     return MUNIT_OK;
 }
 
+/* Connect using custom socket options. */
+TEST(tcp_connect, options, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_uv_tcp_options options;
+    int rv;
+    memset(&options, 0, sizeof options);
+    options.nodelay = true;
+    options.keepalive = 10;
+    options.send_buffer = 1024 * 1024;
+    options.recv_buffer = 1024 * 1024;
+    rv = raft_uv_tcp_set_options(&f->transport, &options);
+    munit_assert_int(rv, ==, 0);
+    CONNECT(2, TCP_SERVER_ADDRESS);
+    return MUNIT_OK;
+}
+
+/* Negative values are rejected. */
+TEST(tcp_connect, badOptions, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    struct raft_uv_tcp_options options;
+    int rv;
+    memset(&options, 0, sizeof options);
+    options.send_buffer = -1;
+    rv = raft_uv_tcp_set_options(&f->transport, &options);
+    munit_assert_int(rv, ==, RAFT_INVALID);
+    munit_assert_string_equal(f->transport.errmsg,
+                              "negative socket option value");
+    return MUNIT_OK;
+}
+
 /* The peer has shutdown */
 TEST(tcp_connect, refused, setUp, tearDown, 0, NULL)
 {
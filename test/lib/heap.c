@@ -103,18 +103,14 @@ static int getIntParam(const MunitParameter params[], const char *name)
     return value != NULL ? atoi(value) : 0;
 }
 
-void HeapSetUp(const MunitParameter params[], struct raft_heap *h)
+void HeapInstanceSetUp(struct raft_heap *h)
 {
     struct heap *heap = munit_malloc(sizeof *heap);
-    int delay = getIntParam(params, TEST_HEAP_FAULT_DELAY);
-    int repeat = getIntParam(params, TEST_HEAP_FAULT_REPEAT);
 
     munit_assert_ptr_not_null(h);
 
     heapInit(heap);
 
-    FaultConfig(&heap->fault, delay, repeat);
-
     h->data = heap;
     h->malloc = heapMalloc;
     h->free = heapFree;
@@ -122,18 +118,41 @@ void HeapSetUp(const MunitParameter params[], struct raft_heap *h)
     h->realloc = heapRealloc;
     h->aligned_alloc = heapAlignedAlloc;
     h->aligned_free = heapAlignedFree;
-
-    raft_heap_set(h);
-    FaultPause(&heap->fault);
 }
 
-void HeapTearDown(struct raft_heap *h)
+void HeapInstanceTearDown(struct raft_heap *h)
 {
     struct heap *heap = h->data;
     if (heap->n != 0) {
         munit_errorf("memory leak: %d outstanding allocations", heap->n);
     }
     free(heap);
+}
+
+int HeapCount(struct raft_heap *h)
+{
+    struct heap *heap = h->data;
+    return heap->n;
+}
+
+void HeapSetUp(const MunitParameter params[], struct raft_heap *h)
+{
+    struct heap *heap;
+    int delay = getIntParam(params, TEST_HEAP_FAULT_DELAY);
+    int repeat = getIntParam(params, TEST_HEAP_FAULT_REPEAT);
+
+    HeapInstanceSetUp(h);
+    heap = h->data;
+
+    FaultConfig(&heap->fault, delay, repeat);
+
+    raft_heap_set(h);
+    FaultPause(&heap->fault);
+}
+
+void HeapTearDown(struct raft_heap *h)
+{
+    HeapInstanceTearDown(h);
     raft_heap_set_default();
 }
 
@@ -27,6 +27,14 @@
 void HeapSetUp(const MunitParameter params[], struct raft_heap *h);
 void HeapTearDown(struct raft_heap *h);
 
+/* Set up a test heap without installing it as the global one, for use as the
+ * heap of a single raft or raft_io instance. */
+void HeapInstanceSetUp(struct raft_heap *h);
+void HeapInstanceTearDown(struct raft_heap *h);
+
+/* Return the number of outstanding allocations of a test heap. */
+int HeapCount(struct raft_heap *h);
+
 void HeapFaultConfig(struct raft_heap *h, int delay, int repeat);
 void HeapFaultEnable(struct raft_heap *h);
 
@@ -38,6 +38,25 @@ TEST(byteCrc32, invalid, NULL, NULL, 0, NULL)
     return MUNIT_OK;
 }
 
+/* The sum of two concatenated buffers can be obtained from their sums. */
+TEST(byteCrc32, combine, NULL, NULL, 0, NULL)
+{
+    uint8_t buf[1000];
+    unsigned crc1;
+    unsigned crc2;
+    size_t i;
+    for (i = 0; i < sizeof buf; i++) {
+        buf[i] = (uint8_t)(i * 7 + 3);
+    }
+    for (i = 0; i <= sizeof buf; i += 125) {
+        crc1 = byteCrc32(buf, i, 0);
+        crc2 = byteCrc32(buf + i, sizeof buf - i, 0);
+        munit_assert_int(byteCrc32Combine(crc1, crc2, sizeof buf - i), ==,
+                         byteCrc32(buf, sizeof buf, 0));
+    }
+    return MUNIT_OK;
+}
+
 /******************************************************************************
  *
  * Convert to little endian representation (least significant byte first).
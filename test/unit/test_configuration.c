@@ -154,6 +154,31 @@ TEST(configurationIndexOf, no_match, setUp, tearDown, 0, NULL)
     return MUNIT_OK;
 }
 
+/* Large configurations are looked up through a hash index, which is kept up to
+ * date when servers are added or removed. */
+TEST(configurationIndexOf, large, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    char address[64];
+    unsigned i;
+    for (i = 0; i < 100; i++) {
+        sprintf(address, "192.168.1.%u:666", i);
+        ADD(i * 7 + 1, address, RAFT_STANDBY);
+    }
+    munit_assert_ptr_not_null(f->configuration.index);
+    for (i = 0; i < 100; i++) {
+        munit_assert_int(INDEX_OF(i * 7 + 1), ==, i);
+    }
+    munit_assert_int(INDEX_OF(2), ==, 100);
+    ADD_ERROR(RAFT_DUPLICATEID, 8, "10.0.0.1:666", RAFT_VOTER);
+    REMOVE(1);
+    for (i = 1; i < 100; i++) {
+        munit_assert_int(INDEX_OF(i * 7 + 1), ==, i - 1);
+    }
+    munit_assert_int(INDEX_OF(1), ==, 99);
+    return MUNIT_OK;
+}
+
 /******************************************************************************
  *
  * configurationIndexOfVoter
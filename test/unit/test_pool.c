@@ -0,0 +1,107 @@
+#include "../../src/pool.h"
+#include "../lib/heap.h"
+#include "../lib/runner.h"
+
+/******************************************************************************
+ *
+ * Fixture
+ *
+ *****************************************************************************/
+
+struct fixture
+{
+    FIXTURE_HEAP;
+    void *pool;
+};
+
+static void *setUp(const MunitParameter params[], MUNIT_UNUSED void *user_data)
+{
+    struct fixture *f = munit_malloc(sizeof *f);
+    SET_UP_HEAP;
+    f->pool = NULL;
+    return f;
+}
+
+static void tearDown(void *data)
+{
+    struct fixture *f = data;
+    poolClose(&f->pool);
+    TEAR_DOWN_HEAP;
+    free(f);
+}
+
+/******************************************************************************
+ *
+ * Helper macros
+ *
+ *****************************************************************************/
+
+/* Size of the objects used in the tests. */
+#define SIZE 64
+
+#define GET poolGet(&f->pool, SIZE)
+#define PUT(OBJECT) poolPut(&f->pool, OBJECT)
+
+/* Number of free objects in the pool. */
+#define N_FREE (f->pool != NULL ? ((struct poolNode *)f->pool)->n : 0)
+
+/******************************************************************************
+ *
+ * poolGet
+ *
+ *****************************************************************************/
+
+SUITE(poolGet)
+
+/* If the pool is empty, a new object is allocated. */
+TEST(poolGet, empty, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    void *object = GET;
+    munit_assert_ptr_not_null(object);
+    PUT(object);
+    return MUNIT_OK;
+}
+
+/* Objects put back into the pool are reused, most recent first. */
+TEST(poolGet, reuse, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    void *object1 = GET;
+    void *object2 = GET;
+    PUT(object1);
+    PUT(object2);
+    munit_assert_int(N_FREE, ==, 2);
+    munit_assert_ptr_equal(GET, object2);
+    munit_assert_ptr_equal(GET, object1);
+    munit_assert_int(N_FREE, ==, 0);
+    PUT(object1);
+    PUT(object2);
+    return MUNIT_OK;
+}
+
+/******************************************************************************
+ *
+ * poolPut
+ *
+ *****************************************************************************/
+
+SUITE(poolPut)
+
+/* Objects put into a full pool are released. */
+TEST(poolPut, full, setUp, tearDown, 0, NULL)
+{
+    struct fixture *f = data;
+    void *objects[POOL__MAX + 1];
+    unsigned i;
+    for (i = 0; i < POOL__MAX + 1; i++) {
+        objects[i] = GET;
+    }
+    for (i = 0; i < POOL__MAX + 1; i++) {
+        PUT(objects[i]);
+    }
+    munit_assert_int(N_FREE, ==, POOL__MAX);
+    munit_assert_ptr_equal(GET, objects[POOL__MAX - 1]);
+    PUT(objects[POOL__MAX - 1]);
+    return MUNIT_OK;
+}
@@ -343,6 +343,51 @@ TEST(UvWriterSubmit, concurrentSame, NULL, NULL, 0, DirAllParams)
     return MUNIT_SKIP; /* TODO: tests hang */
 }
 
+static void contextCloseCb(struct UvWriterContext *context)
+{
+    bool *closed = context->data;
+    *closed = true;
+}
+
+/* Write with two successive writers sharing the same completion context. */
+TEST(UvWriterSubmit, shared, setUpDeps, tearDownDeps, 0, DirAllParams)
+{
+    struct fixture *f = data;
+    struct UvWriterContext context;
+    bool context_closed = false;
+    char path[UV__PATH_SZ];
+    int fd;
+    int rv;
+    SKIP_IF_NO_FIXTURE;
+    context.data = &context_closed;
+    rv = UvWriterContextInit(&context, &f->loop, 2, f->errmsg);
+    munit_assert_int(rv, ==, 0);
+
+    rv = UvWriterInitShared(&f->writer, &context, f->fd, f->direct_io != 0,
+                            f->async_io, f->errmsg);
+    munit_assert_int(rv, ==, 0);
+    f->writer.data = f;
+    f->closed = false;
+    WRITE(1 /* n bufs */, 1 /* content */, 0 /* offset */);
+    CLOSE;
+
+    UvOsJoin(f->dir, "foo", path);
+    rv = UvOsOpen(path, O_WRONLY, 0, &fd);
+    munit_assert_int(rv, ==, 0);
+    rv = UvWriterInitShared(&f->writer, &context, fd, f->direct_io != 0,
+                            f->async_io, f->errmsg);
+    munit_assert_int(rv, ==, 0);
+    f->closed = false;
+    WRITE(1 /* n bufs */, 2 /* content */, f->block_size /* offset */);
+    CLOSE;
+
+    munit_assert_int(context.n_writers, ==, 0);
+    UvWriterContextClose(&context, contextCloseCb);
+    LOOP_RUN_UNTIL(&context_closed);
+    ASSERT_CONTENT(2);
+    return MUNIT_OK;
+}
+
 /* There are not enough resources to create an AIO context to perform the
  * write. */
 TEST(UvWriterSubmit, noResources, setUpDeps, tearDown, 0, DirNoAioParams)